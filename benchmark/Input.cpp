@@ -0,0 +1,176 @@
+#include <benchmark/benchmark.h>
+
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "JsParser.hpp"
+#include "MappedFile.hpp"
+
+using namespace JsCompiler;
+
+namespace {
+// Write a module to a temporary file. Only a few statements are supported by
+// the parser yet, so it is one import followed by the same line, which still
+// sends every token through the lexer.
+class SourceFile {
+ protected:
+  std::filesystem::path path;
+
+ public:
+  size_t size = 0;
+
+  explicit SourceFile(size_t size, const std::string& line = "  ;\n")
+      : path(std::filesystem::temp_directory_path() /
+             ("js-compiler-benchmark-" + std::to_string(size) + ".js")) {
+    std::string source = "import \"a\";\n";
+    while (source.size() < size) source += line;
+    std::ofstream(path, std::ios::binary) << source;
+    this->size = source.size();
+  }
+
+  ~SourceFile() { std::filesystem::remove(path); }
+
+  [[nodiscard]] std::string getPath() const { return path.string(); }
+};
+
+GeneratedParser::Lexer::Statistics parse(
+    std::unique_ptr<GeneratedParser::Lexer> lexer) {
+  const auto& statistics = lexer->getStatistics();
+  auto parser = JsParser::create(std::move(lexer));
+  benchmark::DoNotOptimize(parser->parseExpression());
+  return statistics;
+}
+
+void setLexerCounters(benchmark::State& state,
+                      const GeneratedParser::Lexer::Statistics& statistics) {
+  const auto tokenCount = static_cast<double>(statistics.tokenCount);
+  state.counters["matchers/token"] = statistics.matcherCount / tokenCount;
+  state.counters["dfa/token"] = statistics.dfaCount / tokenCount;
+}
+
+// Go through every byte the same way the lexer does
+void scan(GeneratedParser::Utility::ChunkedInputStream stream) {
+  size_t count = 0;
+  while (stream.peek() != EOF) {
+    stream.read();
+    count++;
+  }
+  benchmark::DoNotOptimize(count);
+}
+
+void setBytesProcessed(benchmark::State& state, const SourceFile& file) {
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) *
+                          static_cast<int64_t>(file.size));
+}
+}  // namespace
+
+static void BM_ScanStream(benchmark::State& state) {
+  SourceFile sourceFile(state.range(0));
+  for (auto _ : state) {
+    std::ifstream stream(sourceFile.getPath(), std::ios::binary);
+    scan(GeneratedParser::Utility::ChunkedInputStream(stream));
+  }
+  setBytesProcessed(state, sourceFile);
+}
+BENCHMARK(BM_ScanStream)->Arg(8 << 20)->Unit(benchmark::kMillisecond);
+
+static void BM_ScanMappedFile(benchmark::State& state) {
+  SourceFile sourceFile(state.range(0));
+  for (auto _ : state) {
+    MappedFile mappedFile(sourceFile.getPath());
+    scan(GeneratedParser::Utility::ChunkedInputStream(mappedFile.view()));
+  }
+  setBytesProcessed(state, sourceFile);
+}
+BENCHMARK(BM_ScanMappedFile)->Arg(8 << 20)->Unit(benchmark::kMillisecond);
+
+static void BM_ParseStream(benchmark::State& state) {
+  SourceFile sourceFile(state.range(0));
+  GeneratedParser::Lexer::Statistics statistics;
+  for (auto _ : state) {
+    std::ifstream stream(sourceFile.getPath(), std::ios::binary);
+    statistics = parse(GeneratedParser::Lexer::create(stream));
+  }
+  setBytesProcessed(state, sourceFile);
+  setLexerCounters(state, statistics);
+}
+BENCHMARK(BM_ParseStream)->Arg(64 << 10)->Unit(benchmark::kMillisecond);
+
+static void BM_ParseMappedFile(benchmark::State& state) {
+  SourceFile sourceFile(state.range(0));
+  GeneratedParser::Lexer::Statistics statistics;
+  for (auto _ : state) {
+    MappedFile mappedFile(sourceFile.getPath());
+    statistics = parse(GeneratedParser::Lexer::create(mappedFile.view()));
+  }
+  setBytesProcessed(state, sourceFile);
+  setLexerCounters(state, statistics);
+}
+BENCHMARK(BM_ParseMappedFile)->Arg(64 << 10)->Unit(benchmark::kMillisecond);
+
+// Only the parser is measured, the input is tokenized beforehand
+static void BM_ParsePretokenized(benchmark::State& state) {
+  SourceFile sourceFile(state.range(0));
+  MappedFile mappedFile(sourceFile.getPath());
+  GeneratedParser::ParseTree::Statistics statistics;
+  for (auto _ : state) {
+    state.PauseTiming();
+    auto parser =
+        JsParser::create(GeneratedParser::Lexer::create(mappedFile.view()));
+    parser->pretokenize();
+    state.ResumeTiming();
+    benchmark::DoNotOptimize(parser->parseExpression());
+    statistics = parser->getParseTreeStatistics();
+  }
+  setBytesProcessed(state, sourceFile);
+  state.counters["nodes"] = static_cast<double>(statistics.nodeCount);
+  state.counters["bytes/KB"] = statistics.getBytesPerSourceKB();
+}
+BENCHMARK(BM_ParsePretokenized)
+    ->Arg(64 << 10)
+    ->Arg(1 << 20)
+    ->Unit(benchmark::kMillisecond);
+
+// Strings in the source make chunks start inside a token
+static void BM_TokenizeParallel(benchmark::State& state) {
+  SourceFile sourceFile(1 << 20, "import \"a; b\";\n  ;\n");
+  GeneratedParser::Lexer::Statistics statistics;
+  MappedFile mappedFile(sourceFile.getPath());
+  for (auto _ : state) {
+    state.PauseTiming();
+    auto lexer = GeneratedParser::Lexer::create(mappedFile.view());
+    const auto& lexerStatistics = lexer->getStatistics();
+    auto parser = JsParser::create(std::move(lexer));
+    state.ResumeTiming();
+    benchmark::DoNotOptimize(parser->tokenize(state.range(0)));
+    statistics = lexerStatistics;
+  }
+  setBytesProcessed(state, sourceFile);
+  setLexerCounters(state, statistics);
+}
+BENCHMARK(BM_TokenizeParallel)
+    ->DenseRange(1, std::max(std::thread::hardware_concurrency(), 1U))
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+
+// Long identifiers, so most of the time is spent in the identifier DFA.
+// The argument is the JsParser::LexerDFAMode.
+static void BM_TokenizeIdentifiers(benchmark::State& state) {
+  SourceFile sourceFile(1 << 20, "  someLongIdentifierName1 ;\n");
+  MappedFile mappedFile(sourceFile.getPath());
+  for (auto _ : state) {
+    state.PauseTiming();
+    auto parser =
+        JsParser::create(GeneratedParser::Lexer::create(mappedFile.view()),
+                         static_cast<JsParser::LexerDFAMode>(state.range(0)));
+    state.ResumeTiming();
+    benchmark::DoNotOptimize(parser->tokenize());
+  }
+  setBytesProcessed(state, sourceFile);
+}
+BENCHMARK(BM_TokenizeIdentifiers)
+    ->DenseRange(0, 2)
+    ->Unit(benchmark::kMillisecond);
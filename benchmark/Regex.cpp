@@ -0,0 +1,122 @@
+#include <benchmark/benchmark.h>
+
+#include <string>
+
+#include "Regex.parser.hpp"
+
+using namespace GeneratedParser;
+
+namespace {
+// A string literal of about the given size, with an escape now and then
+std::string createStringLiteral(size_t size) {
+  std::string literal = "\"";
+  while (literal.size() < size) literal += "abc def\\\"ghi ";
+  return literal + "\"";
+}
+
+// Block comments with some stars inside, and a line of code after each
+std::string createComments(size_t size) {
+  std::string source;
+  while (source.size() < size)
+    source += "/* A comment which goes on * and on ** for a while */\n  ;\n";
+  return source;
+}
+
+// Find every comment end, either with find() or by matching everywhere
+template <class Find>
+void findCommentEnds(benchmark::State& state, Find find) {
+  const std::string source = createComments(state.range(0));
+  const Regex regex(R"(/\*\//)");
+  for (auto _ : state) {
+    size_t count = 0;
+    for (size_t pos = 0; (pos = find(regex, source, pos)) < source.size();)
+      count++;
+    benchmark::DoNotOptimize(count);
+  }
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) *
+                          static_cast<int64_t>(source.size()));
+}
+
+// The regex is matched once per iteration over the whole literal
+void matchStringLiteral(benchmark::State& state, size_t cacheSize) {
+  const std::string literal = createStringLiteral(state.range(0));
+  Regex regex(R"(/"([^\\]|(\\.))*"/)", cacheSize);
+  for (auto _ : state) benchmark::DoNotOptimize(regex.match(literal));
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) *
+                          static_cast<int64_t>(literal.size()));
+}
+}  // namespace
+
+static void BM_RegexLazyDFA(benchmark::State& state) {
+  matchStringLiteral(state, Regex::DEFAULT_CACHE_SIZE);
+}
+BENCHMARK(BM_RegexLazyDFA)->Arg(64 << 10);
+
+static void BM_RegexNFA(benchmark::State& state) {
+  matchStringLiteral(state, 0);
+}
+BENCHMARK(BM_RegexNFA)->Arg(64 << 10);
+
+// Every byte of an identifier is decoded by a code point condition
+static void BM_RegexProperty(benchmark::State& state) {
+  std::string identifier = "a";
+  while (identifier.size() < static_cast<size_t>(state.range(0)))
+    identifier += "b\xc3\xa9";
+  Regex regex(R"(/[$_\p{ID_Start}][$\p{ID_Continue}]*/)");
+  for (auto _ : state) benchmark::DoNotOptimize(regex.match(identifier));
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) *
+                          static_cast<int64_t>(identifier.size()));
+}
+BENCHMARK(BM_RegexProperty)->Arg(64 << 10);
+
+static void BM_RegexFind(benchmark::State& state) {
+  findCommentEnds(state, [](const Regex& regex, std::string_view source,
+                            size_t pos) {
+    const auto found = regex.find(source, pos);
+    return found ? found->end : source.size();
+  });
+}
+BENCHMARK(BM_RegexFind)->Arg(1 << 20);
+
+// Without the prefilter, the automaton is run at every position
+static void BM_RegexFindEverywhere(benchmark::State& state) {
+  findCommentEnds(state, [](const Regex& regex, std::string_view source,
+                            size_t pos) {
+    for (; pos < source.size(); pos++) {
+      Utility::ChunkedInputStream stream(source.substr(pos));
+      if (regex.match(stream)) return pos + stream.tellg();
+    }
+    return source.size();
+  });
+}
+BENCHMARK(BM_RegexFindEverywhere)->Arg(1 << 20);
+
+// Pathological inputs, which stay polynomial and are stopped by the budget
+
+// Nested lookaheads at every position which read to the end of the input.
+// Each pair of a state and a position is only searched once, so the time
+// grows linearly.
+static void BM_RegexLookahead(benchmark::State& state) {
+  const std::string input = std::string(state.range(0), 'a') + "b";
+  Regex regex(R"(/((?=((?=a*b)a)*b)a)*/)");
+  for (auto _ : state) benchmark::DoNotOptimize(regex.match(input));
+  state.SetComplexityN(state.range(0));
+}
+BENCHMARK(BM_RegexLookahead)
+    ->RangeMultiplier(4)
+    ->Range(64, 16 << 10)
+    ->Complexity(benchmark::oN);
+
+// A comment which is never closed, stopped by the budget
+static void BM_RegexUnterminatedComment(benchmark::State& state) {
+  const std::string input = "/*" + std::string(state.range(0), '*');
+  Regex regex(R"(/\/\*([^*]|\*+[^*\/])*\*+\//)", 0);
+  regex.setStepBudget(16 << 10);
+  for (auto _ : state) {
+    try {
+      benchmark::DoNotOptimize(regex.match(input));
+    } catch (const Regex::StepBudgetException&) {
+    }
+  }
+}
+BENCHMARK(BM_RegexUnterminatedComment)->Arg(1 << 20);
@@ -0,0 +1,16 @@
+function(create_benchmark dir_name lib_target)
+  find_package(benchmark)
+  if (benchmark_FOUND)
+    aux_source_directory(${dir_name} BENCHMARK_SRC)
+    add_executable(${PROJECT_NAME}-benchmark ${BENCHMARK_SRC})
+    target_link_libraries(${PROJECT_NAME}-benchmark ${lib_target})
+    target_include_directories(${PROJECT_NAME}-benchmark PUBLIC $<TARGET_PROPERTY:${lib_target},INCLUDE_DIRECTORIES>)
+    target_precompile_headers(${PROJECT_NAME}-benchmark REUSE_FROM ${lib_target})
+    target_link_libraries(
+      ${PROJECT_NAME}-benchmark
+      benchmark::benchmark_main
+    )
+  else()
+    message("${PROJECT_NAME} skip benchmark because benchmark is not found")
+  endif()
+endfunction()
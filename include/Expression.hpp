@@ -15,6 +15,7 @@ class Expression {
 
 class ImportExpression : public Expression {
   FRIEND_TEST(ParserTest, ImportStatement);
+  FRIEND_TEST(ParserTest, PretokenizedImportStatement);
 
  protected:
   const std::string value;
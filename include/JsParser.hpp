@@ -11,11 +11,37 @@ using namespace GeneratedParser;
 
 class JsParser : protected Parser {
  public:
-  static std::unique_ptr<JsParser> create(std::unique_ptr<Lexer> lexer) {
-    return std::make_unique<JsParser>(std::move(lexer));
+  // How the DFAs of the lexer matchers are run
+  enum class LexerDFAMode {
+    Table,
+    // The scanner emitted by the parser generator
+    Emitted,
+    // Compiled at runtime if built with JS_COMPILER_LEXER_JIT, otherwise the
+    // same as Table
+    Jit
+  };
+
+#ifdef JS_COMPILER_LEXER_JIT
+  static constexpr inline LexerDFAMode DEFAULT_LEXER_DFA_MODE =
+      LexerDFAMode::Jit;
+#else
+  static constexpr inline LexerDFAMode DEFAULT_LEXER_DFA_MODE =
+      LexerDFAMode::Emitted;
+#endif
+
+  static std::unique_ptr<JsParser> create(
+      std::unique_ptr<Lexer> lexer,
+      LexerDFAMode lexerDFAMode = DEFAULT_LEXER_DFA_MODE) {
+    return std::make_unique<JsParser>(std::move(lexer), lexerDFAMode);
   }
 
-  explicit JsParser(std::unique_ptr<Lexer> lexer);
+  explicit JsParser(std::unique_ptr<Lexer> lexer,
+                    LexerDFAMode lexerDFAMode = DEFAULT_LEXER_DFA_MODE);
+
+  using Parser::getParseTreeStatistics;
+  using Parser::pretokenize;
+  using Parser::retokenize;
+  using Parser::tokenize;
 
   /**
    * @return {std::unique_ptr<Expression>}  : Parsed expression. Could be
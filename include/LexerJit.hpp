@@ -0,0 +1,47 @@
+#pragma once
+
+#ifdef JS_COMPILER_LEXER_JIT
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "LexerDFA.parser.hpp"
+
+namespace llvm::orc {
+class LLJIT;
+}  // namespace llvm::orc
+
+namespace JsCompiler {
+using namespace GeneratedParser;
+
+/*
+ * Compiles the DFA of a lexer matcher to native code with LLVM ORC. Every
+ * state is a basic block with a switch over the next byte, so the transition
+ * table is never read. The code lives as long as the process, and the same DFA
+ * is only compiled once.
+ */
+class LexerJit {
+ protected:
+  std::unique_ptr<llvm::orc::LLJIT> jit;
+  std::mutex mutex;
+  // Keyed by the DFA and its accepting states
+  std::map<std::string, LexerDFA::ScanFunction> functionMap;
+
+  LexerJit();
+
+ public:
+  ~LexerJit();
+
+  static LexerJit& getInstance();
+
+  /**
+   * @return {LexerDFA::ScanFunction}  : nullptr if the DFA could not be
+   * compiled, so the table is used instead
+   */
+  LexerDFA::ScanFunction compile(const LexerDFA& dfa,
+                                 const std::vector<bool>& acceptedList);
+};
+}  // namespace JsCompiler
+#endif
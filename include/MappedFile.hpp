@@ -0,0 +1,25 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+
+namespace JsCompiler {
+/*
+ * Read-only memory mapping of a whole file. The content stays valid as long as
+ * the object is alive.
+ */
+class MappedFile {
+ protected:
+  const char* data = nullptr;
+  size_t size = 0;
+
+ public:
+  explicit MappedFile(const std::string& fileName);
+  ~MappedFile();
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  [[nodiscard]] std::string_view view() const { return {data, size}; }
+};
+}  // namespace JsCompiler
@@ -2,15 +2,9 @@
 
 #include <string_view>
 
+#include "Utility.parser.hpp"
+
 namespace JsCompiler::Utility {
-// Compile-time string hash
-static constexpr unsigned long hashStartNumber = 5381;
-static constexpr unsigned long hashStepNumber = 5U;
-constexpr unsigned long hash(std::string_view str) {
-  unsigned long hash = hashStartNumber;
-  for (const auto& ch : str) {
-    hash = ((hash << hashStepNumber) + hash) + ch; /* hash * 33 + c */
-  }
-  return hash;
-}
+// Compile-time string hash, the same one used by the generated parser
+using GeneratedParser::Utility::hash;
 }  // namespace JsCompiler::Utility
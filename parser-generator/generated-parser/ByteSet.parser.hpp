@@ -0,0 +1,52 @@
+#pragma once
+
+#include <bitset>
+#include <cstdint>
+#include <vector>
+
+#include "Serializer.parser.hpp"
+
+namespace GeneratedParser {
+// One bit for every byte value
+using ByteSet = std::bitset<256>;
+
+template <>
+class Serializer::Serializer<std::vector<ByteSet>> : public ISerializer {
+ protected:
+  static constexpr inline size_t WORD_SIZE = 64;
+  static constexpr inline size_t WORD_COUNT = 256 / WORD_SIZE;
+
+  std::vector<ByteSet>& byteSetList;
+
+ public:
+  explicit Serializer(std::vector<ByteSet>& byteSetList)
+      : byteSetList(byteSetList) {}
+  explicit Serializer(const std::vector<ByteSet>& byteSetList)
+      : byteSetList(const_cast<std::vector<ByteSet>&>(byteSetList)) {}
+
+  void serialize(BinaryOfStream& os) const override {
+    Serializer<size_t>(byteSetList.size()).serialize(os);
+    for (const auto& byteSet : byteSetList) {
+      for (size_t i = 0; i < WORD_COUNT; i++) {
+        uint64_t word = 0;
+        for (size_t bit = 0; bit < WORD_SIZE; bit++)
+          if (byteSet.test(i * WORD_SIZE + bit)) word |= uint64_t{1} << bit;
+        os.write(reinterpret_cast<const char*>(&word), sizeof(word));
+      }
+    }
+  }
+
+  void deserialize(BinaryIfStream& stream) override {
+    size_t size = 0;
+    Serializer<size_t>(size).deserialize(stream);
+    byteSetList.assign(size, {});
+    for (auto& byteSet : byteSetList) {
+      for (size_t i = 0; i < WORD_COUNT; i++) {
+        auto word = stream.read<uint64_t>();
+        for (size_t bit = 0; bit < WORD_SIZE; bit++)
+          if (word & (uint64_t{1} << bit)) byteSet.set(i * WORD_SIZE + bit);
+      }
+    }
+  }
+};
+}  // namespace GeneratedParser
@@ -1,42 +1,309 @@
 #pragma once
 
 #include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <limits>
+#include <list>
 #include <ranges>
+#include <span>
 #include <stdexcept>
 #include <string>
 #include <unordered_map>
+#include <utility>
+#include <vector>
 
 #include "LLTableBase.parser.hpp"
 #include "Serializer.parser.hpp"
 
 namespace GeneratedParser {
-class GeneratedLLTable : public LLTableBase<size_t, size_t> {
-  friend class Parser;
+// A symbol of GeneratedLLTable packed into 32 bits
+class PackedSymbol {
+ public:
+  enum Type : uint32_t { Terminal, NonTerminal, End };
+
+  static constexpr inline size_t MAX_VALUE = (size_t{1} << 30) - 1;
+
+  Type type : 2 = End;
+
+ protected:
+  uint32_t value : 30 = 0;
+
+ public:
+  constexpr explicit PackedSymbol(Type type, size_t value = 0)
+      : type(type), value(static_cast<uint32_t>(value)) {
+    assert(value <= MAX_VALUE);
+  }
+  constexpr PackedSymbol() = default;
+
+  static constexpr inline PackedSymbol createNonTerminal(size_t value) {
+    return PackedSymbol(NonTerminal, value);
+  }
+
+  static constexpr inline PackedSymbol createTerminal(size_t value) {
+    return PackedSymbol(Terminal, value);
+  }
+
+  [[nodiscard]] size_t getNonTerminal() const {
+    assert(type == NonTerminal);
+    return value;
+  }
+
+  [[nodiscard]] size_t getTerminal() const {
+    assert(type == Terminal);
+    return value;
+  }
+
+  constexpr bool operator==(const PackedSymbol& another) const {
+    return type == another.type && value == another.value;
+  }
+
+  constexpr bool operator!=(const PackedSymbol& another) const {
+    return !((*this) == another);
+  }
+};
+
+/*
+ * The LL(1) table written by the generator, laid out for prediction. Every
+ * production has an id, and the table is a dense [nonterminal][terminal, END]
+ * matrix of ids. The right sides of all productions are stored one after
+ * another in a single array, so a prediction is a span into it.
+ */
+class GeneratedLLTable {
+  friend class Serializer::Serializer<GeneratedLLTable>;
+
+ public:
+  using Symbol = PackedSymbol;
+
+  static constexpr inline Symbol END{Symbol::End};
+
+  using ProductionId = uint16_t;
+  static constexpr inline ProductionId NO_PRODUCTION =
+      std::numeric_limits<ProductionId>::max();
+
+  // The table as it is serialized by the generator
+  using SerializedSymbol = LLTableBase<size_t, size_t>::Symbol;
+  using SerializedTable = std::unordered_map<
+      size_t, std::unordered_map<SerializedSymbol, std::list<SerializedSymbol>,
+                                 SerializedSymbol::Hash>>;
+
+ protected:
+  size_t start = 0;
+  size_t nonTerminalCount = 0;
+  // The terminals of the table and END, which is the last column
+  size_t columnCount = 1;
+  // [nonTerminal * columnCount + column]
+  std::vector<ProductionId> predictionTable;
+  // The right side of production i is
+  // symbolPool[productionOffsetList[i], productionOffsetList[i + 1])
+  std::vector<uint32_t> productionOffsetList{0};
+  std::vector<Symbol> symbolPool;
+  // Indexed by production
+  std::vector<uint32_t> productionLeftList;
+
+  static Symbol pack(const SerializedSymbol& symbol) {
+    switch (symbol.type) {
+      case SerializedSymbol::Terminal:
+        return Symbol::createTerminal(symbol.getTerminal());
+      case SerializedSymbol::NonTerminal:
+        return Symbol::createNonTerminal(symbol.getNonTerminal());
+      default:
+        return END;
+    }
+  }
+
+  // @return {size_t}  : columnCount if the symbol has no column
+  [[nodiscard]] size_t getColumn(const Symbol& symbol) const {
+    switch (symbol.type) {
+      case Symbol::Terminal:
+        return symbol.getTerminal() < columnCount - 1 ? symbol.getTerminal()
+                                                      : columnCount;
+      case Symbol::End:
+        return columnCount - 1;
+      default:
+        return columnCount;
+    }
+  }
+
+  // Number everything, and give each distinct production of a nonterminal
+  // one id
+  void build(const SerializedTable& table) {
+    size_t terminalCount = 0;
+    for (const auto& [left, leftMap] : table) {
+      nonTerminalCount = std::max(nonTerminalCount, left + 1);
+      for (const auto& [symbol, children] : leftMap) {
+        if (symbol.type == SerializedSymbol::Terminal)
+          terminalCount = std::max(terminalCount, symbol.getTerminal() + 1);
+        for (const auto& child : children)
+          if (child.type == SerializedSymbol::NonTerminal)
+            nonTerminalCount =
+                std::max(nonTerminalCount, child.getNonTerminal() + 1);
+      }
+    }
+    if (std::max(nonTerminalCount, terminalCount) > Symbol::MAX_VALUE)
+      throw std::runtime_error("Too many symbols in the table");
+    columnCount = terminalCount + 1;
+    predictionTable.assign(nonTerminalCount * columnCount, NO_PRODUCTION);
+
+    // Sorted, so the ids do not depend on the hash order
+    std::vector<size_t> leftList;
+    for (const auto& [left, _] : table) leftList.push_back(left);
+    std::ranges::sort(leftList);
+    for (const size_t& left : leftList) {
+      std::vector<std::pair<size_t, const std::list<SerializedSymbol>*>>
+          entryList;
+      for (const auto& [symbol, children] : table.at(left))
+        entryList.emplace_back(getColumn(pack(symbol)), &children);
+      std::ranges::sort(entryList);
+      const size_t firstId = productionLeftList.size();
+      for (const auto& [column, children] : entryList) {
+        std::vector<Symbol> right;
+        for (const auto& child : *children) right.push_back(pack(child));
+        size_t id = firstId;
+        while (id < productionLeftList.size() &&
+               !std::ranges::equal(getProduction(id), right))
+          id++;
+        if (id == productionLeftList.size()) {
+          if (id == NO_PRODUCTION)
+            throw std::runtime_error("Too many productions in the table");
+          symbolPool.insert(symbolPool.end(), right.begin(), right.end());
+          productionOffsetList.push_back(symbolPool.size());
+          productionLeftList.push_back(left);
+        }
+        predictionTable[left * columnCount + column] =
+            static_cast<ProductionId>(id);
+      }
+    }
+  }
 
  public:
-  auto getCandidate(const size_t& nonTerminal) {
-    return std::views::keys(table.at(nonTerminal)) |
-           std::views::filter([](const Symbol& symbol) {
-             return symbol.type == Symbol::Terminal;
-           }) |
-           std::views::transform(
-               [](const Symbol& symbol) { return symbol.getTerminal(); });
+  [[nodiscard]] const size_t& getStart() const { return start; }
+
+  // Nonterminals are numbered from 0, including the ones only used on the
+  // right side
+  [[nodiscard]] size_t getNonTerminalCount() const { return nonTerminalCount; }
+
+  [[nodiscard]] size_t getProductionCount() const {
+    return productionLeftList.size();
+  }
+
+  [[nodiscard]] std::span<const Symbol> getProduction(size_t id) const {
+    return {symbolPool.data() + productionOffsetList[id],
+            symbolPool.data() + productionOffsetList[id + 1]};
+  }
+
+  // Terminals which predict a production of the nonterminal
+  [[nodiscard]] auto getCandidate(size_t nonTerminal) const {
+    return std::views::iota(size_t{0}, columnCount - 1) |
+           std::views::filter([this, nonTerminal](size_t terminal) {
+             return predictionTable[nonTerminal * columnCount + terminal] !=
+                    NO_PRODUCTION;
+           });
+  }
+
+  /**
+   * Terminals which can come right after a terminal, from the productions in
+   * the table. It can be more than what the parser expects at some point.
+   *
+   * @return {std::vector<std::vector<bool>>}  : Indexed by terminal
+   */
+  [[nodiscard]] std::vector<std::vector<bool>> getFollowList(
+      size_t terminalCount) const {
+    // Sets of terminals are bitmaps with wordCount words each
+    using Word = uint64_t;
+    constexpr size_t WORD_BITS = 64;
+    const size_t wordCount = (terminalCount + WORD_BITS - 1) / WORD_BITS;
+    auto set = [wordCount](std::vector<Word>& setList, size_t index,
+                           size_t terminal) {
+      setList[index * wordCount + terminal / WORD_BITS] |=
+          Word{1} << (terminal % WORD_BITS);
+    };
+
+    // Terminals a nonterminal can start with. It already has the ones after
+    // the nonterminal if it can be empty.
+    std::vector<Word> firstList(nonTerminalCount * wordCount);
+    for (size_t nonTerminal = 0; nonTerminal < nonTerminalCount; nonTerminal++)
+      for (const size_t terminal : getCandidate(nonTerminal))
+        set(firstList, nonTerminal, terminal);
+
+    std::vector<Word> nonTerminalFollowList(nonTerminalCount * wordCount);
+    std::vector<Word> terminalFollowList(terminalCount * wordCount);
+    bool isChanged = false;
+    auto merge = [&isChanged, wordCount](Word* to, const Word* from) {
+      for (size_t i = 0; i < wordCount; i++) {
+        if ((from[i] & ~to[i]) == 0) continue;
+        to[i] |= from[i];
+        isChanged = true;
+      }
+    };
+    // Fixed point iteration
+    do {
+      isChanged = false;
+      for (size_t id = 0; id < getProductionCount(); id++) {
+        const size_t left = productionLeftList[id];
+        const auto children = getProduction(id);
+        for (auto it = children.begin(); it != children.end(); it++) {
+          if (it->type == Symbol::End) continue;
+          Word* followSet =
+              it->type == Symbol::Terminal
+                  ? &terminalFollowList[it->getTerminal() * wordCount]
+                  : &nonTerminalFollowList[it->getNonTerminal() * wordCount];
+          auto nextIt = std::next(it);
+          if (nextIt == children.end())
+            merge(followSet, &nonTerminalFollowList[left * wordCount]);
+          else if (nextIt->type == Symbol::NonTerminal)
+            merge(followSet, &firstList[nextIt->getNonTerminal() * wordCount]);
+          else if (nextIt->type == Symbol::Terminal) {
+            const size_t terminal = nextIt->getTerminal();
+            const Word bit = Word{1} << (terminal % WORD_BITS);
+            if ((followSet[terminal / WORD_BITS] & bit) == 0) {
+              followSet[terminal / WORD_BITS] |= bit;
+              isChanged = true;
+            }
+          }
+        }
+      }
+    } while (isChanged);
+
+    std::vector<std::vector<bool>> followList(
+        terminalCount, std::vector<bool>(terminalCount));
+    for (size_t from = 0; from < terminalCount; from++)
+      for (size_t to = 0; to < terminalCount; to++)
+        followList[from][to] =
+            (terminalFollowList[from * wordCount + to / WORD_BITS] >>
+             (to % WORD_BITS)) &
+            1;
+    return followList;
   }
 
-  std::list<Symbol> predict(const Symbol& currentSymbol,
-                            const Symbol& nextInput) const noexcept(false) {
+  /**
+   * @return {std::span<const Symbol>}  : Empty if there is no prediction. An
+   * empty production is [END], so it is never empty otherwise.
+   */
+  [[nodiscard]] std::span<const Symbol> findPrediction(
+      const Symbol& currentSymbol, const Symbol& nextInput) const {
     assert(currentSymbol.type == Symbol::NonTerminal);
-    const auto& leftMap = table.at(currentSymbol.getNonTerminal());
-    if (!leftMap.contains(nextInput))
-      throw std::runtime_error("No match prediction");
-    return leftMap.at(nextInput);
+    const size_t nonTerminal = currentSymbol.getNonTerminal();
+    const size_t column = getColumn(nextInput);
+    if (nonTerminal >= nonTerminalCount || column == columnCount) return {};
+    const ProductionId id = predictionTable[nonTerminal * columnCount + column];
+    return id != NO_PRODUCTION ? getProduction(id) : std::span<const Symbol>{};
+  }
+
+  std::span<const Symbol> predict(const Symbol& currentSymbol,
+                                  const Symbol& nextInput) const
+      noexcept(false) {
+    const auto children = findPrediction(currentSymbol, nextInput);
+    if (children.empty()) throw std::runtime_error("No match prediction");
+    return children;
   }
 };
 
 template <>
-class Serializer::Serializer<GeneratedLLTable::Symbol> : public ISerializer {
+class Serializer::Serializer<GeneratedLLTable::SerializedSymbol>
+    : public ISerializer {
  protected:
-  using Symbol = GeneratedLLTable::Symbol;
+  using Symbol = GeneratedLLTable::SerializedSymbol;
 
   Symbol& symbol;
 
@@ -48,24 +315,42 @@ class Serializer::Serializer<GeneratedLLTable::Symbol> : public ISerializer {
   void deserialize(BinaryIfStream& stream) override {
     BinaryIType type = stream.get();
     switch (type) {
-      case GeneratedLLTable::Symbol::Terminal: {
+      case Symbol::Terminal: {
         size_t terminal = 0;
         Serializer<size_t>(terminal).deserialize(stream);
         symbol = Symbol::createTerminal(terminal);
         break;
       }
-      case GeneratedLLTable::Symbol::NonTerminal: {
+      case Symbol::NonTerminal: {
         size_t nonTerminal;
         Serializer<size_t>(nonTerminal).deserialize(stream);
         symbol = Symbol::createNonTerminal(nonTerminal);
         break;
       }
-      case GeneratedLLTable::Symbol::End:
-        symbol = GeneratedLLTable::END;
+      case Symbol::End:
+        symbol = Symbol(Symbol::End);
         break;
       default:
         throw std::runtime_error("Unknow symbol type: " + std::to_string(type));
     }
   }
 };
+
+// The start symbol and the table written by the generator
+template <>
+class Serializer::Serializer<GeneratedLLTable> : public ISerializer {
+ protected:
+  GeneratedLLTable& table;
+
+ public:
+  explicit Serializer(GeneratedLLTable& table) : table(table) {}
+
+  void deserialize(BinaryIfStream& stream) override {
+    Serializer<size_t>(table.start).deserialize(stream);
+    GeneratedLLTable::SerializedTable serializedTable;
+    Serializer<GeneratedLLTable::SerializedTable>(serializedTable)
+        .deserialize(stream);
+    table.build(serializedTable);
+  }
+};
 }  // namespace GeneratedParser
@@ -1,32 +1,37 @@
 #pragma once
 
 #include <algorithm>
+#include <array>
+#include <cassert>
+#include <exception>
+#include <functional>
 #include <istream>
 #include <iterator>
 #include <memory>
 #include <regex>
+#include <span>
 #include <stdexcept>
 #include <string>
 #include <string_view>
+#include <thread>
 #include <unordered_map>
 #include <unordered_set>
 #include <utility>
 #include <variant>
 #include <vector>
 
+#include "ByteSet.parser.hpp"
+#include "LexerDFA.parser.hpp"
+#include "PerfectHash.parser.hpp"
+#include "Position.parser.hpp"
 #include "Regex.parser.hpp"
+#include "Scanner.parser.hpp"
 #include "Serializer.parser.hpp"
+#include "Token.parser.hpp"
+#include "Unicode.parser.hpp"
 #include "Utility.parser.hpp"
 
 namespace GeneratedParser {
-using TokenType = int;
-static inline const TokenType Eof = -1;
-
-struct Token {
-  TokenType type = -1;
-  std::string value;
-};
-
 class Lexer {
  protected:
   struct Matcher;
@@ -36,17 +41,43 @@ class Lexer {
       std::vector<std::unique_ptr<Lexer::Matcher>>>;
   friend class Parser;
 
+  struct CandidateSet;
+  struct TokenizeTable;
+
  protected:
-  using Stream = Utility::ForwardBufferedInputStream;
+  using Stream = Utility::ChunkedInputStream;
 
-  Stream stream;
   Token currentToken;
 
+ public:
+  struct Statistics {
+    size_t tokenCount = 0;
+    // Runs of the fallback matchers, including the ones from exclusion
+    size_t matcherCount = 0;
+    size_t dfaCount = 0;
+  };
+
+  /*
+   * Compile a DFA to native code, given whether each of its states accepts.
+   * It returns nullptr if the DFA is left to the table.
+   */
+  using DFACompiler = std::function<LexerDFA::ScanFunction(
+      const LexerDFA&, const std::vector<bool>& acceptedList)>;
+
+ protected:
   struct MatchState;
   struct Matcher {
     virtual ~Matcher() = default;
 
     [[nodiscard]] virtual bool match(Stream&, MatchState&) = 0;
+
+    [[nodiscard]] virtual bool isString() const { return false; }
+
+    // Only a regex takes steps
+    virtual void setStepBudget(size_t) {}
+
+    // @return {bool}  : Whether the matcher runs native code from now on
+    virtual bool compileDFA(const DFACompiler&) { return false; }
   };
 
   struct StringMatcher : public Matcher {
@@ -62,11 +93,13 @@ class Lexer {
       }
       return true;
     }
+
+    [[nodiscard]] bool isString() const override { return true; }
   };
 
   struct RegexMatcher : public Matcher {
    protected:
-    const Regex regex;
+    Regex regex;
 
    public:
     explicit RegexMatcher(const std::string_view& regexStr)
@@ -75,11 +108,15 @@ class Lexer {
     [[nodiscard]] bool match(Stream& stream, MatchState&) override {
       return regex.match(stream);
     }
+
+    void setStepBudget(size_t stepBudget) override {
+      regex.setStepBudget(stepBudget);
+    }
   };
 
   struct RegexExcludeMatcher : public Matcher {
    protected:
-    const Regex regex;
+    Regex regex;
     const std::vector<size_t> excludeList;
 
    public:
@@ -89,107 +126,879 @@ class Lexer {
 
     [[nodiscard]] bool match(Stream& stream, MatchState& state) override {
       size_t pos = stream.tellg();
-      if (regex.match(stream)) {
-        size_t regexEndPos = stream.tellg();
-        bool isNotExcluded =
-            std::find_if(excludeList.begin(), excludeList.end(),
-                         [&state, &stream, &pos](size_t index) {
-                           stream.seekg(pos);
-                           return state.match(index, stream);
-                         }) == excludeList.end();
-        stream.seekg(regexEndPos);
-        return isNotExcluded;
+      return regex.match(stream) && !state.isExcluded(excludeList, stream, pos);
+    }
+
+    void setStepBudget(size_t stepBudget) override {
+      regex.setStepBudget(stepBudget);
+    }
+  };
+
+  // A terminal with a DFA of its own, e.g. a regex without the terminals it
+  // excludes, so it is decided in one pass
+  struct DFAMatcher : public Matcher {
+   protected:
+    static constexpr inline size_t NOT_MATCHED = -1;
+
+    const LexerDFA dfa;
+    // Indexed by state
+    const std::vector<bool> acceptedList;
+    LexerDFA::ScanFunction scan = nullptr;
+
+   public:
+    explicit DFAMatcher(LexerDFA dfa)
+        : dfa(std::move(dfa)), acceptedList(this->dfa.createAcceptedList(0)) {}
+
+    bool compileDFA(const DFACompiler& compile) override {
+      scan = compile(dfa, acceptedList);
+      return scan != nullptr;
+    }
+
+    [[nodiscard]] bool match(Stream& stream, MatchState&) override {
+      LexerDFA::StateType state = LexerDFA::START;
+      size_t endPos = acceptedList[state] ? stream.tellg() : NOT_MATCHED;
+      if (scan != nullptr) {
+        std::string_view window;
+        while (!(window = stream.peekWindow()).empty()) {
+          size_t length = 0;
+          size_t acceptedLength = NOT_MATCHED;
+          state = scan(state, window.data(), window.size(), &length,
+                       &acceptedLength);
+          if (acceptedLength != NOT_MATCHED)
+            endPos = stream.tellg() + acceptedLength;
+          stream.skip(length);
+          if (length < window.size()) break;
+        }
+      } else {
+        int ch;
+        while ((ch = stream.peek()) != EOF) {
+          state = dfa.next(state, static_cast<unsigned char>(ch));
+          if (state == LexerDFA::DEAD) break;
+          stream.read();
+          if (acceptedList[state]) endPos = stream.tellg();
+        }
       }
+      if (endPos == NOT_MATCHED) return false;
+      stream.seekg(endPos);
+      return true;
+    }
+  };
+
+  // Same as /[s\p{ID_Start}][p\p{ID_Continue}]*/ without the excluded
+  // terminals, e.g. an identifier which is not a keyword. An ASCII identifier
+  // is decided by a DFA without the excluded ASCII strings, so a keyword is
+  // told apart in the same pass. Only the bytes above ASCII are decoded.
+  struct IdentifierMatcher : public Matcher {
+   protected:
+    // Indexed by byte, whether it is an ASCII identifier part. Bytes above
+    // ASCII are not, so they leave the table lookup.
+    std::array<bool, 256> partList{};
+    // Excluded terminals which are not in the DFA
+    const std::vector<size_t> excludeList;
+    const LexerDFA dfa;
+    // Indexed by state
+    const std::vector<bool> acceptedList;
+    LexerDFA::ScanFunction scan = nullptr;
+
+    // Match a code point above ASCII with the property
+    static bool matchCodePoint(Stream& stream, Unicode::Property property) {
+      const size_t pos = stream.tellg();
+      size_t length = 0;
+      const char32_t codePoint =
+          Unicode::decode([&stream] { return stream.get(); }, length);
+      if (codePoint != Unicode::INVALID &&
+          Unicode::hasProperty(codePoint, property))
+        return true;
+      stream.seekg(pos);
       return false;
     }
+
+   public:
+    IdentifierMatcher(std::string_view extraPart,
+                      std::vector<size_t> excludeList, LexerDFA dfa)
+        : excludeList(std::move(excludeList)),
+          dfa(std::move(dfa)),
+          acceptedList(this->dfa.createAcceptedList(0)) {
+      for (unsigned char ch = 0; ch < 0x80; ch++)
+        partList[ch] = Unicode::getAsciiProperties(ch) & Unicode::IdContinue;
+      for (const char& ch : extraPart)
+        partList[static_cast<unsigned char>(ch)] = true;
+    }
+
+    bool compileDFA(const DFACompiler& compile) override {
+      scan = compile(dfa, acceptedList);
+      return scan != nullptr;
+    }
+
+    [[nodiscard]] bool match(Stream& stream, MatchState& state) override {
+      const size_t pos = stream.tellg();
+      LexerDFA::StateType dfaState = LexerDFA::START;
+      stream.skipUntil([this, &dfaState](std::string_view window) {
+        // A word is decided by its last state, not by its longest accepted
+        // prefix, so the accepted length is not asked for
+        if (scan != nullptr) {
+          size_t length = 0;
+          dfaState = scan(dfaState, window.data(), window.size(), &length,
+                          nullptr);
+          return length;
+        }
+        size_t i = 0;
+        for (; i < window.size(); i++) {
+          const auto next =
+              dfa.next(dfaState, static_cast<unsigned char>(window[i]));
+          if (next == LexerDFA::DEAD) break;
+          dfaState = next;
+        }
+        return i;
+      });
+      // EOF is below 0x80 as well
+      if (stream.peek() < 0x80 ||
+          !matchCodePoint(stream, dfaState == LexerDFA::START
+                                      ? Unicode::IdStart
+                                      : Unicode::IdContinue))
+        return acceptedList[dfaState] &&
+               !state.isExcluded(excludeList, stream, pos);
+      // No excluded string in the DFA can match any more
+      while (true) {
+        stream.skipUntil([this](std::string_view window) {
+          size_t i = 0;
+          while (i < window.size() &&
+                 partList[static_cast<unsigned char>(window[i])])
+            i++;
+          return i;
+        });
+        // EOF is below 0x80 as well
+        if (stream.peek() < 0x80 ||
+            !matchCodePoint(stream, Unicode::IdContinue))
+          break;
+      }
+      return !state.isExcluded(excludeList, stream, pos);
+    }
   };
 
+  // Same as /[^c]*/
+  struct UntilByteMatcher : public Matcher {
+   protected:
+    const char end;
+
+   public:
+    explicit UntilByteMatcher(char end) : end(end){};
+
+    [[nodiscard]] bool match(Stream& stream, MatchState&) override {
+      stream.skipUntil([this](std::string_view window) {
+        return Scanner::findByte(window, end);
+      });
+      return true;
+    }
+  };
+
+  // Same as /([^a]|(a(?!b)))*/, which stops before "ab"
+  struct UntilSequenceMatcher : public Matcher {
+   protected:
+    const char first;
+    const char second;
+
+   public:
+    UntilSequenceMatcher(char first, char second)
+        : first(first), second(second){};
+
+    [[nodiscard]] bool match(Stream& stream, MatchState&) override {
+      while (true) {
+        stream.skipUntil([this](std::string_view window) {
+          return Scanner::findByte(window, first);
+        });
+        size_t pos = stream.tellg();
+        if (stream.get() == EOF) break;
+        if (stream.peek() == static_cast<unsigned char>(second)) {
+          stream.seekg(pos);
+          break;
+        }
+      }
+      return true;
+    }
+  };
+
+  // Same as /q([^q\\]|(\\.))*q/
+  struct QuotedMatcher : public Matcher {
+   protected:
+    const char quote;
+
+   public:
+    explicit QuotedMatcher(char quote) : quote(quote){};
+
+    [[nodiscard]] bool match(Stream& stream, MatchState&) override {
+      if (stream.get() != static_cast<unsigned char>(quote)) return false;
+      while (true) {
+        stream.skipUntil([this](std::string_view window) {
+          return Scanner::findEitherByte(window, quote, '\\');
+        });
+        int ch = stream.get();
+        if (ch == EOF) return false;
+        if (ch == static_cast<unsigned char>(quote)) return true;
+        // Escaped char
+        if (stream.get() == EOF) return false;
+      }
+    }
+  };
+
+  /*
+   * Result of every matcher at the current token start. It is allocated once,
+   * and a new token only bumps the generation, which invalidates all entries.
+   */
   struct MatchState {
    protected:
-    std::unordered_map<size_t, int> cache;
+    static constexpr inline size_t NOT_MATCHED = -1;
+
     const std::vector<std::unique_ptr<Matcher>>& matcherList;
+    const PerfectHash& stringHash;
+    Statistics& statistics;
+
+    size_t generation = 0;
+    // Indexed by terminal. An entry is valid if its generation is current.
+    std::vector<size_t> generationList;
+    std::vector<size_t> endPosList;
 
    public:
-    explicit MatchState(
-        const std::vector<std::unique_ptr<Matcher>>& matcherList)
-        : matcherList(matcherList) {}
+    MatchState(const std::vector<std::unique_ptr<Matcher>>& matcherList,
+               const PerfectHash& stringHash, Statistics& statistics)
+        : matcherList(matcherList),
+          stringHash(stringHash),
+          statistics(statistics) {}
 
-    bool match(size_t index, Stream& stream) {
-      if (!cache.contains(index)) {
-        if (matcherList.at(index)->match(stream, *this))
-          cache.emplace(index, static_cast<int>(stream.tellg()));
-        else
-          cache.emplace(index, -1);
-      } else
-        stream.seekg(cache.at(index));
-      return cache.at(index) > -1;
+    [[nodiscard]] bool isString(size_t index) const {
+      return matcherList[index]->isString();
     }
 
-    int getMatchedPos() {
-      auto it = std::find_if(cache.begin(), cache.end(),
-                             [](std::pair<size_t, int> singleMatch) {
-                               return singleMatch.second > -1;
-                             });
-      return it != cache.end() ? it->second : -1;
+    // @return {uint32_t}  : The string terminal, or PerfectHash::NOT_FOUND
+    [[nodiscard]] uint32_t findString(std::string_view str) const {
+      return stringHash.find(str);
+    }
+
+    /**
+     * Whether the text from pos to the current position is exactly matched
+     * by an excluded terminal, same as the DFA does. All strings are checked
+     * by a single lookup. The stream is left at the current position.
+     */
+    bool isExcluded(const std::vector<size_t>& excludeList, Stream& stream,
+                    size_t pos) {
+      if (excludeList.empty()) return false;
+      const size_t endPos = stream.tellg();
+      const uint32_t string = findString(stream.substr(pos, endPos - pos));
+      auto isMatchedBy = [&](size_t index) {
+        if (index == string) return true;
+        if (isString(index)) return false;
+        stream.seekg(pos);
+        return match(index, stream) && stream.tellg() == endPos;
+      };
+      const bool isExcluded = std::ranges::any_of(excludeList, isMatchedBy);
+      stream.seekg(endPos);
+      return isExcluded;
+    }
+
+    // Start a new token
+    void reset() {
+      if (generationList.size() != matcherList.size()) {
+        generationList.assign(matcherList.size(), 0);
+        endPosList.assign(matcherList.size(), NOT_MATCHED);
+      }
+      generation++;
+    }
+
+    bool match(size_t index, Stream& stream) {
+      if (generationList[index] != generation) {
+        generationList[index] = generation;
+        endPosList[index] = NOT_MATCHED;
+        statistics.matcherCount++;
+        if (matcherList[index]->match(stream, *this))
+          endPosList[index] = stream.tellg();
+      } else if (endPosList[index] != NOT_MATCHED)
+        stream.seekg(endPosList[index]);
+      return endPosList[index] != NOT_MATCHED;
     }
   };
 
   std::vector<std::unique_ptr<Matcher>> matcherList;
+  LexerDFA dfa;
+  // Indexed by terminal
+  std::vector<ByteSet> firstByteSetList;
+  PerfectHash stringHash;
+  // Indexed by terminal. Of two matches with the same length, the one with
+  // the lower rank wins.
+  std::vector<size_t> rankList;
+
+  // Everything needed to read tokens from a position. Every worker of
+  // tokenize() has its own, and all of them share the matchers and the DFA.
+  struct Cursor {
+    Stream stream;
+    Statistics statistics;
+    MatchState matchState;
+    // Bytes after the last token which decided it
+    size_t lookahead = 0;
+
+    Cursor(Stream stream, const Lexer& lexer)
+        : stream(std::move(stream)),
+          matchState(lexer.matcherList, lexer.stringHash, statistics) {}
+  };
+
+  Cursor cursor;
+  // Built on demand
+  LineIndex lineIndex;
+
+  /**
+   * Find the longest match of the expected terminals covered by the DFA. The
+   * stream is left at the start position.
+   *
+   * @return {std::pair<TokenType, size_t>}  : The matched terminal and the
+   * end position. The terminal is Eof if nothing is matched.
+   */
+  std::pair<TokenType, size_t> matchDFA(
+      Cursor& cursor, const std::vector<bool>& isExpected) const {
+    Stream& stream = cursor.stream;
+    size_t startPos = stream.tellg();
+    std::pair<TokenType, size_t> matched{Eof, startPos};
+    size_t wordEndPos = startPos;
+    auto accept = [&](LexerDFA::StateType state) {
+      TokenType accepted = Eof;
+      for (const auto& terminal : dfa.getAcceptList(state)) {
+        const auto type = static_cast<TokenType>(terminal);
+        if (terminal == dfa.wordTerminal)
+          wordEndPos = stream.tellg();
+        else if (isExpected[terminal] &&
+                 (accepted == Eof || isPreferred(type, accepted)))
+          accepted = type;
+      }
+      if (accepted != Eof) matched = {accepted, stream.tellg()};
+    };
+    LexerDFA::StateType state = LexerDFA::START;
+    accept(state);
+    int ch;
+    while ((ch = stream.peek()) != EOF) {
+      state = dfa.next(state, static_cast<unsigned char>(ch));
+      if (state == LexerDFA::DEAD) break;
+      stream.read();
+      accept(state);
+    }
+    if (wordEndPos > startPos) {
+      TokenType wordMatched = matchWord(
+          stream.substr(startPos, wordEndPos - startPos), isExpected);
+      if (wordMatched != Eof &&
+          (matched.first == Eof || wordEndPos > matched.second ||
+           (wordEndPos == matched.second &&
+            isPreferred(wordMatched, matched.first))))
+        matched = {wordMatched, wordEndPos};
+    }
+    stream.seekg(startPos);
+    return matched;
+  }
+
+  /**
+   * Tell the strings excluded by the word (e.g. keywords) from the word
+   * itself with one lookup.
+   *
+   * @return {TokenType}  : The expected terminal with the lowest rank, or Eof
+   * if there is none
+   */
+  [[nodiscard]] TokenType matchWord(std::string_view word,
+                                    const std::vector<bool>& isExpected) const {
+    const uint32_t string = stringHash.find(word);
+    TokenType matched = Eof;
+    if (string != PerfectHash::NOT_FOUND && isExpected[string])
+      matched = static_cast<TokenType>(string);
+    const auto wordTerminal = static_cast<TokenType>(dfa.wordTerminal);
+    if (isExpected[dfa.wordTerminal] &&
+        (string == PerfectHash::NOT_FOUND || !dfa.isWordExcluded(string)) &&
+        (matched == Eof || isPreferred(wordTerminal, matched)))
+      matched = wordTerminal;
+    return matched;
+  }
+
+  [[nodiscard]] bool isPreferred(TokenType type, TokenType another) const {
+    return rankList[type] < rankList[another];
+  }
+
+  /*
+   * A string terminal is written out in the grammar, so it is more specific
+   * than a pattern which matches the same text, like a keyword and an
+   * identifier. Otherwise the terminal used first in the grammar wins.
+   */
+  void buildRankList() {
+    rankList.resize(matcherList.size());
+    for (size_t terminal = 0; terminal < matcherList.size(); terminal++)
+      rankList[terminal] =
+          (matcherList[terminal]->isString() ? 0 : matcherList.size()) +
+          terminal;
+  }
 
   [[nodiscard]] virtual inline bool isEof(const char& ch) const {
     return ch == EOF;
   }
 
-  [[nodiscard]] virtual inline bool isSpace(const char& ch) const {
-    return std::isspace(ch);
+  static void skipSpace(Stream& stream) {
+    stream.skipUntil(Scanner::findNotSpace);
   }
 
+  void setCurrentToken(TokenType type, size_t startPos) {
+    currentToken = {type, {startPos, cursor.stream.tellg() - startPos}};
+  }
+
+  /**
+   * Read one token with maximal munch: the longest match wins, then the
+   * terminal with the lowest rank. Space must be skipped and the stream must
+   * not be at EOF.
+   *
+   * @return {TokenType}  : The matched terminal, and the stream is left after
+   * it. Eof if nothing is matched, and the stream is not moved.
+   */
+  TokenType matchToken(Cursor& cursor, const CandidateSet& candidateSet) const {
+    Stream& stream = cursor.stream;
+    size_t startPos = stream.tellg();
+    stream.resetFurthest();
+    cursor.statistics.tokenCount++;
+    const auto firstByte = static_cast<unsigned char>(stream.peek());
+    std::pair<TokenType, size_t> matched{Eof, startPos};
+    auto isBetter = [this, &matched](TokenType type, size_t endPos) {
+      return matched.first == Eof || endPos > matched.second ||
+             (endPos == matched.second && isPreferred(type, matched.first));
+    };
+    cursor.matchState.reset();
+    try {
+      for (const size_t& index : candidateSet.matcherIndexList) {
+        if (!firstByteSetList[index].test(firstByte)) continue;
+        if (cursor.matchState.match(index, stream) &&
+            isBetter(static_cast<TokenType>(index), stream.tellg()))
+          matched = {static_cast<TokenType>(index), stream.tellg()};
+        stream.seekg(startPos);
+      }
+    } catch (const Regex::StepBudgetException&) {
+      // This can run on a worker, which has no line index of its own
+      throw stream.createSyntaxError("Regex step budget exceeded", startPos);
+    }
+    if (candidateSet.dfaFirstByteSet.test(firstByte)) {
+      cursor.statistics.dfaCount++;
+      auto [dfaMatchedType, dfaMatchedPos] =
+          matchDFA(cursor, candidateSet.isExpected);
+      if (dfaMatchedType != Eof && isBetter(dfaMatchedType, dfaMatchedPos))
+        matched = {dfaMatchedType, dfaMatchedPos};
+    }
+    stream.seekg(matched.second);
+    cursor.lookahead = stream.getFurthest() + 1 - matched.second;
+    return matched.first;
+  }
+
+  // Tokens of a chunk lexed by tokenize() from a guessed start
+  struct Chunk {
+    // Only tokens starting in [start, end) belong to the chunk
+    size_t start = 0;
+    size_t end = 0;
+    TokenBuffer tokenBuffer;
+    // After the last token
+    size_t endPos = 0;
+    // Candidate set of the first token
+    size_t first = 0;
+    Statistics statistics;
+    // Thrown while the chunk is lexed, it is rethrown by the caller
+    std::exception_ptr exception;
+  };
+
+  /**
+   * Lex a chunk as if a token starts at its first byte after space. It stops
+   * at the first unexpected token, which leaves the rest to mergeChunk().
+   * Anything thrown is kept in the chunk, because it runs on a worker.
+   */
+  void lexChunk(Chunk& chunk, std::string_view source,
+                const TokenizeTable& tokenizeTable) const noexcept;
+
+  /**
+   * Append the tokens really starting in a chunk. Tokens are read from the
+   * real position until both the position and the expected terminals meet a
+   * token of the chunk, then the rest of the chunk is taken as is.
+   */
+  void mergeChunk(TokenBuffer& tokenBuffer, const Chunk& chunk,
+                  const TokenizeTable& tokenizeTable);
+
  public:
   static std::unique_ptr<Lexer> create(std::istream& stream) {
     return std::make_unique<Lexer>(stream);
   }
 
-  explicit Lexer(std::istream& stream) : stream(stream) {}
+  /**
+   * @param  source : Contiguous source which must outlive the lexer. It is
+   * read in place without any copy.
+   */
+  static std::unique_ptr<Lexer> create(std::string_view source) {
+    return std::make_unique<Lexer>(source);
+  }
+
+  // The input must be UTF-8, which is checked in bulk before it is lexed
+  explicit Lexer(std::istream& stream) : cursor(Stream(stream), *this) {
+    cursor.stream.checkUtf8();
+  }
+  explicit Lexer(std::string_view source) : cursor(Stream(source), *this) {
+    cursor.stream.checkUtf8();
+  }
+
+  // Lex another source from its start, e.g. the same file after an edit
+  void reset(std::string_view source) {
+    cursor.stream = Stream(source);
+    cursor.stream.checkUtf8();
+    currentToken = {};
+    lineIndex = {};
+  }
+
+  // Load the matchers, the DFA, the first byte sets and the string hash
+  void deserialize(Serializer::BinaryDeserializer& deserializer) {
+    deserializer.deserialize(matcherList);
+    deserializer.deserialize(dfa);
+    deserializer.deserialize(firstByteSetList);
+    deserializer.deserialize(stringHash);
+    buildRankList();
+    setStepBudget(DEFAULT_STEP_BUDGET);
+  }
+
+  // Far more than any real token takes, so only a pathological input hits it
+  static constexpr inline size_t DEFAULT_STEP_BUDGET = 1 << 24;
+
+  /**
+   * Limit the steps of a regex matcher for one token, see
+   * Regex::setStepBudget(). A token which exceeds it throws SyntaxError at
+   * its start, so a bad input can not stall the lexer or a worker of
+   * tokenize().
+   */
+  void setStepBudget(size_t stepBudget) {
+    for (auto& matcher : matcherList) matcher->setStepBudget(stepBudget);
+  }
+
+  [[nodiscard]] size_t getTerminalCount() const { return matcherList.size(); }
+
+  /**
+   * Run the DFA of every matcher which has one of its own with native code.
+   * It must be called before any token is read.
+   *
+   * @return {size_t}  : The number of matchers compiled
+   */
+  size_t compileDFAMatchers(const DFACompiler& compile) {
+    return std::ranges::count_if(matcherList, [&compile](auto& matcher) {
+      return matcher->compileDFA(compile);
+    });
+  }
+
+  /**
+   * Run the DFA matchers with the scan functions emitted by the parser
+   * generator. A function is skipped if the fingerprint of its DFA is not the
+   * one of the matcher, e.g. it is emitted from an older grammar. It must be
+   * called before any token is read.
+   *
+   * @return {size_t}  : The number of matchers which use an emitted function
+   */
+  size_t setEmittedScans(
+      std::span<const LexerDFA::EmittedScan> emittedScanList) {
+    return std::ranges::count_if(
+        emittedScanList, [this](const LexerDFA::EmittedScan& emittedScan) {
+          return emittedScan.terminal < matcherList.size() &&
+                 matcherList[emittedScan.terminal]->compileDFA(
+                     [&emittedScan](const LexerDFA& dfa,
+                                    const std::vector<bool>& acceptedList) {
+                       return dfa.getFingerprint(acceptedList) ==
+                                      emittedScan.fingerprint
+                                  ? emittedScan.scan
+                                  : nullptr;
+                     });
+        });
+  }
+
+  // Expected terminals. It is built once, so reading a token does not need
+  // any allocation.
+  struct CandidateSet {
+    // Indexed by terminal, only set for terminals matched by the DFA
+    std::vector<bool> isExpected;
+    // Terminals left to the matchers, in ascending order
+    std::vector<size_t> matcherIndexList;
+    // Bytes any terminal in isExpected can start with
+    ByteSet dfaFirstByteSet;
+  };
 
   template <class Iterable>
-  void readNextTokenExpect(Iterable matcherIndexIterable) {
+  [[nodiscard]] CandidateSet createCandidateSet(
+      Iterable matcherIndexIterable) const {
+    CandidateSet candidateSet{std::vector<bool>(matcherList.size()), {}, {}};
+    for (const size_t& index : matcherIndexIterable) {
+      if (dfa.isCovered(index)) {
+        candidateSet.isExpected[index] = true;
+        candidateSet.dfaFirstByteSet |= firstByteSetList.at(index);
+      } else
+        candidateSet.matcherIndexList.push_back(index);
+    }
+    std::ranges::sort(candidateSet.matcherIndexList);
+    return candidateSet;
+  }
+
+  void readNextTokenExpect(const CandidateSet& candidateSet) {
+    Stream& stream = cursor.stream;
+    skipSpace(stream);
+    size_t startPos = stream.tellg();
     if (stream.peek() == EOF) {
-      currentToken = {Eof, ""};
+      setCurrentToken(Eof, startPos);
       return;
     }
+    TokenType type = matchToken(cursor, candidateSet);
+    if (type == Eof) throw createSyntaxError("Unexpected token");
+    setCurrentToken(type, startPos);
+  }
 
-    while (isSpace(static_cast<char>(stream.peek()))) {
-      stream.read();
+  void readNextTokenExpectEof() {
+    Stream& stream = cursor.stream;
+    skipSpace(stream);
+    if (stream.peek() == EOF) {
+      setCurrentToken(Eof, stream.tellg());
+      return;
     }
-    stream.shrinkBufferToIndex();
+    throw createSyntaxError("Expecting EOF but get " +
+                            std::to_string(stream.peek()));
+  }
 
-    MatchState state(matcherList);
-    size_t startPos = stream.tellg();
-    for (const size_t& index : matcherIndexIterable) {
-      if (state.match(index, stream))
-        currentToken = {static_cast<TokenType>(index),
-                        stream.getBufferToIndexAsString()};
-      stream.seekg(startPos);
+  /*
+   * Expected terminals of a token when there is no parser to ask. They only
+   * depend on the terminal before the token, so the input can be lexed
+   * without parsing it.
+   */
+  struct TokenizeTable {
+    // Candidate sets without duplicates
+    std::vector<CandidateSet> candidateSetList;
+    // Indexes of candidateSetList. The first token of the input uses start,
+    // and the first token of a chunk uses guess.
+    size_t start = 0;
+    size_t guess = 0;
+    // Indexed by the terminal before the token
+    std::vector<size_t> followList;
+
+    [[nodiscard]] size_t getNext(TokenType type) const {
+      return followList[type];
     }
-    int matchedPos = state.getMatchedPos();
-    if (matchedPos == -1) throw std::runtime_error("Unexpected token");
-    stream.seekg(matchedPos);
+  };
 
-    stream.shrinkBufferToIndex();
+  /**
+   * Read every token left, and every token is expected by the terminal
+   * before it. The lexer is left at EOF.
+   */
+  [[nodiscard]] TokenBuffer tokenize(const TokenizeTable& tokenizeTable) {
+    TokenBuffer tokenBuffer;
+    size_t next = tokenizeTable.start;
+    while (true) {
+      readNextTokenExpect(tokenizeTable.candidateSetList[next]);
+      if (currentToken.type == Eof) break;
+      tokenBuffer.push(currentToken.type, currentToken.span, cursor.lookahead);
+      next = tokenizeTable.getNext(currentToken.type);
+    }
+    return tokenBuffer;
   }
 
-  void readNextTokenExpectEof() {
-    if (stream.peek() == EOF) {
-      currentToken = {Eof, ""};
-      return;
+  static constexpr inline size_t MIN_CHUNK_SIZE = 64 * 1024;
+
+  /**
+   * Same result as tokenize(tokenizeTable), with the input split into
+   * chunks which are lexed in parallel. A chunk is lexed from a guess, and
+   * it is corrected while the chunks are merged in order. The input is read
+   * to the end first. What a worker throws is rethrown here after all of
+   * them are joined.
+   *
+   * @param  threadCount  : Number of chunks, one thread each
+   * @param  minChunkSize : Fewer chunks are used for a small input
+   */
+  [[nodiscard]] TokenBuffer tokenize(const TokenizeTable& tokenizeTable,
+                                     size_t threadCount,
+                                     size_t minChunkSize = MIN_CHUNK_SIZE) {
+    Stream& stream = cursor.stream;
+    // The lexer never drops input, so the buffer starts at 0
+    const std::string_view source = stream.readAll();
+    if (source.size() > TokenBuffer::MAX_SOURCE_SIZE)
+      throw std::runtime_error("Source is too large to tokenize");
+    const size_t start = stream.tellg();
+    const size_t size = source.size() - start;
+    const size_t chunkCount =
+        std::min(threadCount, size / std::max(minChunkSize, size_t{1}));
+    if (chunkCount <= 1) return tokenize(tokenizeTable);
+
+    std::vector<Chunk> chunkList(chunkCount);
+    for (size_t i = 0; i < chunkCount; i++) {
+      chunkList[i].start = start + size * i / chunkCount;
+      chunkList[i].end = start + size * (i + 1) / chunkCount;
+      chunkList[i].first = tokenizeTable.guess;
+    }
+    // The first chunk starts at the real position, so it needs no guess
+    chunkList[0].first = tokenizeTable.start;
+    {
+      std::vector<std::jthread> workerList;
+      for (size_t i = 1; i < chunkCount; i++)
+        workerList.emplace_back([&, i] {
+          lexChunk(chunkList[i], source, tokenizeTable);
+        });
+      lexChunk(chunkList[0], source, tokenizeTable);
     }
-    throw std::runtime_error("Expecting EOF but get " +
-                             std::to_string(stream.peek()));
+
+    // Chunks before the one which throws are merged first, so an error
+    // earlier in the input is thrown instead
+    TokenBuffer tokenBuffer;
+    for (const Chunk& chunk : chunkList) {
+      if (chunk.exception) std::rethrow_exception(chunk.exception);
+      mergeChunk(tokenBuffer, chunk, tokenizeTable);
+      cursor.statistics.tokenCount += chunk.statistics.tokenCount;
+      cursor.statistics.matcherCount += chunk.statistics.matcherCount;
+      cursor.statistics.dfaCount += chunk.statistics.dfaCount;
+    }
+    skipSpace(stream);
+    setCurrentToken(Eof, stream.tellg());
+    return tokenBuffer;
+  }
+
+  /**
+   * Update the tokens of the previous source after an edit, which gives the
+   * same result as tokenize() of the current source. Tokens are lexed again
+   * from the last one before the edit, until a token starts at the same
+   * place with the same expected terminals as an old one after the edit.
+   *
+   * @param  tokenBuffer : Tokens of the previous source from tokenize(). It
+   * is updated in place, and it is not changed if an error is thrown.
+   */
+  TokenChange relex(const TokenizeTable& tokenizeTable,
+                    TokenBuffer& tokenBuffer, const TextEdit& edit) {
+    Stream& stream = cursor.stream;
+    if (stream.readAll().size() > TokenBuffer::MAX_SOURCE_SIZE)
+      throw std::runtime_error("Source is too large to tokenize");
+    const size_t editEnd = edit.offset + edit.removedLength;
+    const size_t insertedEnd = edit.offset + edit.insertedLength;
+    // Candidate set of an old token
+    auto getOldNext = [&](size_t index) {
+      return index == 0 ? tokenizeTable.start
+                        : tokenizeTable.getNext(tokenBuffer.getType(index - 1));
+    };
+
+    // Tokens before first did not look at the edit, so they are the same
+    const size_t first = tokenBuffer.findLookingAt(edit.offset);
+    if (first == 0)
+      stream.seekg(0);
+    else {
+      const Span span = tokenBuffer.getSpan(first - 1);
+      stream.seekg(span.offset + span.length);
+    }
+    size_t next = getOldNext(first);
+    TokenBuffer relexed;
+    size_t old = first;
+    while (true) {
+      skipSpace(stream);
+      const size_t startPos = stream.tellg();
+      if (stream.peek() == EOF) {
+        old = tokenBuffer.size();
+        break;
+      }
+      if (startPos >= insertedEnd) {
+        const size_t oldPos = startPos - insertedEnd + editEnd;
+        while (old < tokenBuffer.size() &&
+               tokenBuffer.getSpan(old).offset < oldPos)
+          old++;
+        if (old < tokenBuffer.size() &&
+            tokenBuffer.getSpan(old).offset == oldPos &&
+            getOldNext(old) == next)
+          break;
+      }
+      const TokenType type =
+          matchToken(cursor, tokenizeTable.candidateSetList[next]);
+      if (type == Eof) throw createSyntaxError("Unexpected token", startPos);
+      relexed.push(type, {startPos, stream.tellg() - startPos},
+                   cursor.lookahead);
+      next = tokenizeTable.getNext(type);
+    }
+    tokenBuffer.replace(first, old - first, relexed, 0, relexed.size(),
+                        static_cast<std::ptrdiff_t>(edit.insertedLength) -
+                            static_cast<std::ptrdiff_t>(edit.removedLength));
+    return {first, old - first, relexed.size()};
   }
 
   [[nodiscard]] const Token& getCurrentToken() const { return currentToken; };
+
+  [[nodiscard]] const Statistics& getStatistics() const {
+    return cursor.statistics;
+  }
+
+  // The line index is only built when this is called
+  [[nodiscard]] Position getPosition(size_t offset) {
+    Stream& stream = cursor.stream;
+    lineIndex.extend(stream.substr(0, stream.getBufferedEnd()));
+    return lineIndex.getPosition(offset);
+  }
+
+  // Error at the current position
+  [[nodiscard]] SyntaxError createSyntaxError(const std::string& message) {
+    return createSyntaxError(message, cursor.stream.tellg());
+  }
+
+  [[nodiscard]] SyntaxError createSyntaxError(const std::string& message,
+                                              size_t offset) {
+    return {message, offset, getPosition(offset)};
+  }
+
+  /**
+   * The whole source is kept by the lexer, so a span stays valid for the
+   * lifetime of the lexer. The returned view is only invalidated when more
+   * input is read from a std::istream.
+   */
+  [[nodiscard]] std::string_view getText(const Span& span) const {
+    return cursor.stream.substr(span.offset, span.length);
+  }
 };
 
+inline void Lexer::lexChunk(Chunk& chunk, std::string_view source,
+                            const TokenizeTable& tokenizeTable) const noexcept {
+  try {
+    Cursor cursor(Stream(source), *this);
+    Stream& stream = cursor.stream;
+    stream.seekg(chunk.start);
+    chunk.endPos = chunk.start;
+    size_t next = chunk.first;
+    while (true) {
+      skipSpace(stream);
+      size_t startPos = stream.tellg();
+      if (startPos >= chunk.end || stream.peek() == EOF) break;
+      TokenType type =
+          matchToken(cursor, tokenizeTable.candidateSetList[next]);
+      if (type == Eof) break;
+      chunk.tokenBuffer.push(type, {startPos, stream.tellg() - startPos},
+                             cursor.lookahead);
+      chunk.endPos = stream.tellg();
+      next = tokenizeTable.getNext(type);
+    }
+    chunk.statistics = cursor.statistics;
+  } catch (...) {
+    chunk.exception = std::current_exception();
+  }
+}
+
+inline void Lexer::mergeChunk(TokenBuffer& tokenBuffer, const Chunk& chunk,
+                              const TokenizeTable& tokenizeTable) {
+  Stream& stream = cursor.stream;
+  // Candidate set of the token at index
+  auto getNext = [&tokenizeTable](const TokenBuffer& tokenBuffer, size_t index,
+                                  size_t first) {
+    return index == 0 ? first
+                      : tokenizeTable.getNext(tokenBuffer.getType(index - 1));
+  };
+  while (true) {
+    skipSpace(stream);
+    size_t startPos = stream.tellg();
+    if (startPos >= chunk.end || stream.peek() == EOF) return;
+    const size_t next =
+        getNext(tokenBuffer, tokenBuffer.size(), tokenizeTable.start);
+    const size_t index = chunk.tokenBuffer.find(startPos);
+    if (index < chunk.tokenBuffer.size() &&
+        getNext(chunk.tokenBuffer, index, chunk.first) == next) {
+      tokenBuffer.append(chunk.tokenBuffer, index);
+      stream.seekg(chunk.endPos);
+      continue;
+    }
+    readNextTokenExpect(tokenizeTable.candidateSetList[next]);
+    tokenBuffer.push(currentToken.type, currentToken.span, cursor.lookahead);
+  }
+}
+
 template <>
 class Serializer::Serializer<std::vector<std::unique_ptr<Lexer::Matcher>>>
     : ISerializer {
@@ -230,6 +1039,39 @@ class Serializer::Serializer<std::vector<std::unique_ptr<Lexer::Matcher>>>
               std::make_unique<Lexer::RegexExcludeMatcher>(regex, excludeList);
           break;
         }
+        case 3:
+          matcherList[i++] = std::make_unique<Lexer::UntilByteMatcher>(
+              static_cast<char>(stream.get()));
+          break;
+        case 4: {
+          const auto first = static_cast<char>(stream.get());
+          const auto second = static_cast<char>(stream.get());
+          matcherList[i++] =
+              std::make_unique<Lexer::UntilSequenceMatcher>(first, second);
+          break;
+        }
+        case 5:
+          matcherList[i++] = std::make_unique<Lexer::QuotedMatcher>(
+              static_cast<char>(stream.get()));
+          break;
+        case 6: {
+          std::string_view extraPart;
+          Serializer<std::string_view>(extraPart).deserialize(stream);
+          std::vector<size_t> excludeList;
+          Serializer<std::vector<size_t>>(excludeList).deserialize(stream);
+          LexerDFA dfa;
+          Serializer<LexerDFA>(dfa).deserialize(stream);
+          matcherList[i++] = std::make_unique<Lexer::IdentifierMatcher>(
+              extraPart, excludeList, std::move(dfa));
+          break;
+        }
+        case 7: {
+          LexerDFA dfa;
+          Serializer<LexerDFA>(dfa).deserialize(stream);
+          matcherList[i++] =
+              std::make_unique<Lexer::DFAMatcher>(std::move(dfa));
+          break;
+        }
         default:
           throw std::runtime_error("Unknow symbol type: " +
                                    std::to_string(type));
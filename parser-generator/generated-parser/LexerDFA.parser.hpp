@@ -0,0 +1,204 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "Serializer.parser.hpp"
+
+namespace GeneratedParser {
+/*
+ * A minimized DFA over all terminals which can be matched byte by byte. Each
+ * accepting state is tagged with the terminal indices it accepts, so the
+ * longest match of any terminal set can be found in a single forward pass.
+ */
+struct LexerDFA {
+  using StateType = uint32_t;
+
+  /**
+   * Native code of a DFA, e.g. compiled by a JIT. It runs the DFA from state
+   * over data, until the next state is DEAD or data ends.
+   *
+   * @param  length         : Set to the bytes consumed
+   * @param  acceptedLength : Set to the bytes consumed when an accepting
+   * state is entered, and left as is if none is. Nullable, when only the
+   * state is needed.
+   * @return {StateType}  : The state after the bytes consumed
+   */
+  using ScanFunction = StateType (*)(StateType state, const char* data,
+                                     size_t size, size_t* length,
+                                     size_t* acceptedLength);
+
+  // Scan function of the DFA of a terminal, emitted as C++ by the parser
+  // generator
+  struct EmittedScan {
+    size_t terminal;
+    // Of the DFA it is emitted from, see getFingerprint()
+    uint64_t fingerprint;
+    ScanFunction scan;
+  };
+
+  static constexpr inline StateType START = 0;
+  static constexpr inline StateType DEAD =
+      std::numeric_limits<StateType>::max();
+  static constexpr inline uint32_t NO_WORD =
+      std::numeric_limits<uint32_t>::max();
+
+  // Bytes which can not be told apart by any state share the same class
+  std::array<uint8_t, 256> byteClassMap{};
+  size_t byteClassCount = 0;
+  // stateCount * byteClassCount
+  std::vector<StateType> transitionTable;
+  // The accepted terminals of state i are
+  // acceptList[acceptOffsetList[i], acceptOffsetList[i + 1])
+  std::vector<uint32_t> acceptOffsetList;
+  std::vector<uint32_t> acceptList;
+  // Whether a terminal is matched by this DFA, indexed by terminal
+  std::vector<bool> coveredList;
+  // The word (e.g. identifier) is accepted without excluding any string. The
+  // excluded strings it accepts are not in the DFA, so the maximal word must
+  // be looked up to tell them apart.
+  uint32_t wordTerminal = NO_WORD;
+  // Strings the word does not accept, in ascending order
+  std::vector<uint32_t> wordExcludeList;
+
+  [[nodiscard]] bool empty() const { return transitionTable.empty(); }
+
+  [[nodiscard]] size_t getStateCount() const {
+    return acceptOffsetList.empty() ? 0 : acceptOffsetList.size() - 1;
+  }
+
+  [[nodiscard]] bool isCovered(size_t terminal) const {
+    return terminal < coveredList.size() && coveredList[terminal];
+  }
+
+  [[nodiscard]] bool isWordExcluded(uint32_t terminal) const {
+    return std::ranges::binary_search(wordExcludeList, terminal);
+  }
+
+  [[nodiscard]] StateType next(StateType state, unsigned char ch) const {
+    return transitionTable[state * byteClassCount + byteClassMap[ch]];
+  }
+
+  [[nodiscard]] std::span<const uint32_t> getAcceptList(
+      StateType state) const {
+    return {acceptList.data() + acceptOffsetList[state],
+            acceptList.data() + acceptOffsetList[state + 1]};
+  }
+
+  // @return {std::vector<bool>}  : Whether each state accepts the terminal
+  [[nodiscard]] std::vector<bool> createAcceptedList(uint32_t terminal) const {
+    std::vector<bool> acceptedList(getStateCount());
+    for (StateType state = 0; state < acceptedList.size(); state++)
+      acceptedList[state] =
+          std::ranges::binary_search(getAcceptList(state), terminal);
+    return acceptedList;
+  }
+
+  /**
+   * FNV-1a hash of the transitions and the accepting states, which is all a
+   * scan function is built from. It tells whether native code, e.g. from an
+   * older build, belongs to this DFA.
+   *
+   * @param  acceptedList : Whether each state accepts, see
+   * createAcceptedList()
+   */
+  [[nodiscard]] uint64_t getFingerprint(
+      const std::vector<bool>& acceptedList) const {
+    uint64_t hash = 0xcbf29ce484222325;
+    auto add = [&hash](uint64_t value) {
+      for (size_t i = 0; i < sizeof(value); i++) {
+        hash ^= (value >> (i * 8)) & 0xff;
+        hash *= 0x100000001b3;
+      }
+    };
+    add(getStateCount());
+    add(byteClassCount);
+    for (const auto& byteClass : byteClassMap) add(byteClass);
+    for (const auto& next : transitionTable) add(next);
+    for (const bool accepted : acceptedList) add(accepted);
+    return hash;
+  }
+};
+
+/**
+ * Defined by the file written with --emit-lexer, which must be compiled in to
+ * call it.
+ *
+ * @return {std::span<const LexerDFA::EmittedScan>}  : Ordered by terminal
+ */
+std::span<const LexerDFA::EmittedScan> getEmittedScanList();
+
+template <>
+class Serializer::Serializer<LexerDFA> : public ISerializer {
+ protected:
+  LexerDFA& dfa;
+
+  template <typename Type>
+  static void serializeArray(BinaryOfStream& os, const Type* data,
+                             size_t size) {
+    Serializer<size_t>(size).serialize(os);
+    os.write(reinterpret_cast<const char*>(data),
+             static_cast<std::streamsize>(size * sizeof(Type)));
+  }
+
+  template <typename Type>
+  static void deserializeArray(BinaryIfStream& stream, Type* data,
+                               size_t size) {
+    for (size_t i = 0; i < size; i++) data[i] = stream.read<Type>();
+  }
+
+  template <typename Type>
+  static void deserializeArray(BinaryIfStream& stream,
+                               std::vector<Type>& vector) {
+    size_t size = 0;
+    Serializer<size_t>(size).deserialize(stream);
+    vector.resize(size);
+    deserializeArray(stream, vector.data(), size);
+  }
+
+ public:
+  explicit Serializer(LexerDFA& dfa) : dfa(dfa) {}
+  explicit Serializer(const LexerDFA& dfa)
+      : dfa(const_cast<LexerDFA&>(dfa)) {}
+
+  void serialize(BinaryOfStream& os) const override {
+    serializeArray(os, dfa.byteClassMap.data(), dfa.byteClassMap.size());
+    Serializer<size_t>(dfa.byteClassCount).serialize(os);
+    serializeArray(os, dfa.transitionTable.data(), dfa.transitionTable.size());
+    serializeArray(os, dfa.acceptOffsetList.data(),
+                   dfa.acceptOffsetList.size());
+    serializeArray(os, dfa.acceptList.data(), dfa.acceptList.size());
+    std::vector<uint8_t> coveredList(dfa.coveredList.begin(),
+                                     dfa.coveredList.end());
+    serializeArray(os, coveredList.data(), coveredList.size());
+    serializeArray(os, &dfa.wordTerminal, 1);
+    serializeArray(os, dfa.wordExcludeList.data(), dfa.wordExcludeList.size());
+  }
+
+  void deserialize(BinaryIfStream& stream) override {
+    size_t byteClassMapSize = 0;
+    Serializer<size_t>(byteClassMapSize).deserialize(stream);
+    if (byteClassMapSize != dfa.byteClassMap.size())
+      throw std::runtime_error("Invalid byte class map size: " +
+                               std::to_string(byteClassMapSize));
+    deserializeArray(stream, dfa.byteClassMap.data(), byteClassMapSize);
+    Serializer<size_t>(dfa.byteClassCount).deserialize(stream);
+    deserializeArray(stream, dfa.transitionTable);
+    deserializeArray(stream, dfa.acceptOffsetList);
+    deserializeArray(stream, dfa.acceptList);
+    std::vector<uint8_t> coveredList;
+    deserializeArray(stream, coveredList);
+    dfa.coveredList = {coveredList.begin(), coveredList.end()};
+    std::vector<uint32_t> wordTerminal;
+    deserializeArray(stream, wordTerminal);
+    dfa.wordTerminal = wordTerminal.at(0);
+    deserializeArray(stream, dfa.wordExcludeList);
+  }
+};
+}  // namespace GeneratedParser
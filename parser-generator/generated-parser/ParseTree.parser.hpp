@@ -0,0 +1,115 @@
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+#include "LLTable.parser.hpp"
+#include "Token.parser.hpp"
+
+namespace GeneratedParser {
+/*
+ * All nodes of a parse live in one buffer, which only grows at the end like a
+ * bump arena and is freed at once with the tree. The children of a node are
+ * allocated together when it is expanded, so a node only keeps the index of
+ * its first child and the count. Terminals keep their source span.
+ */
+class ParseTree {
+ public:
+  struct Node {
+    PackedSymbol symbol;
+    uint32_t childCount = 0;
+    // Index of the first child in the tree
+    uint32_t firstChild = 0;
+    // Source range of a terminal
+    uint32_t offset = 0;
+    uint32_t length = 0;
+
+    [[nodiscard]] Span getSpan() const { return {offset, length}; }
+  };
+
+  static constexpr inline uint32_t ROOT = 0;
+
+  struct Statistics {
+    size_t nodeCount = 0;
+    // Of the buffer, including the capacity not used yet
+    size_t byteCount = 0;
+    size_t sourceSize = 0;
+
+    [[nodiscard]] double getBytesPerSourceKB() const {
+      return sourceSize == 0 ? 0
+                             : static_cast<double>(byteCount) * 1024 /
+                                   static_cast<double>(sourceSize);
+    }
+  };
+
+ protected:
+  std::vector<Node> nodeList;
+  size_t sourceSize = 0;
+
+ public:
+  explicit ParseTree(PackedSymbol root) { nodeList.push_back({root}); }
+
+  [[nodiscard]] const Node& operator[](uint32_t index) const {
+    return nodeList[index];
+  }
+
+  [[nodiscard]] const Node& getRoot() const { return nodeList[ROOT]; }
+
+  [[nodiscard]] std::span<const Node> getChildren(const Node& node) const {
+    return {nodeList.data() + node.firstChild, node.childCount};
+  }
+
+  /**
+   * Append the children of a node. References to nodes are invalidated, but
+   * indices are not.
+   *
+   * @return {uint32_t}  : The index of the first child
+   */
+  uint32_t addChildren(uint32_t parent, std::span<const PackedSymbol> symbols) {
+    if (nodeList.size() + symbols.size() > std::numeric_limits<uint32_t>::max())
+      throw std::runtime_error("Too many nodes in the parse tree");
+    const auto first = static_cast<uint32_t>(nodeList.size());
+    for (const auto& symbol : symbols) nodeList.push_back({symbol});
+    nodeList[parent].firstChild = first;
+    nodeList[parent].childCount = static_cast<uint32_t>(symbols.size());
+    return first;
+  }
+
+  void setSpan(uint32_t index, const Span& span) {
+    if (span.offset + span.length > std::numeric_limits<uint32_t>::max())
+      throw std::runtime_error("Source is too large for the parse tree");
+    nodeList[index].offset = static_cast<uint32_t>(span.offset);
+    nodeList[index].length = static_cast<uint32_t>(span.length);
+  }
+
+  void setSourceSize(size_t size) { sourceSize = size; }
+
+  /*
+   * Remove the nonterminals which derive nothing. Children always come after
+   * their parent, so going backwards sees every child before its parent, and
+   * the children left are moved to the front of their range.
+   */
+  void removeEmpty() {
+    for (size_t index = nodeList.size(); index-- > 0;) {
+      Node& node = nodeList[index];
+      if (node.symbol.type != PackedSymbol::NonTerminal) continue;
+      uint32_t count = 0;
+      for (uint32_t i = 0; i < node.childCount; i++) {
+        const Node& child = nodeList[node.firstChild + i];
+        if (child.symbol.type == PackedSymbol::NonTerminal &&
+            child.childCount == 0)
+          continue;
+        nodeList[node.firstChild + count++] = child;
+      }
+      node.childCount = count;
+    }
+  }
+
+  [[nodiscard]] Statistics getStatistics() const {
+    return {nodeList.size(), nodeList.capacity() * sizeof(Node), sourceSize};
+  }
+};
+}  // namespace GeneratedParser
@@ -1,9 +1,16 @@
 #pragma once
 
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <ranges>
 #include <stdexcept>
+#include <string_view>
+#include <vector>
 
 #include "LLTable.parser.hpp"
 #include "Lexer.parser.hpp"
+#include "ParseTree.parser.hpp"
 #include "Serializer.parser.hpp"
 
 namespace GeneratedParser {
@@ -15,101 +22,206 @@ class Parser {
 
   GeneratedLLTable table;
 
-  struct Node {
-    const Symbol symbol;
-    std::string value;
-
-    Node* previousNode;
-    std::list<Node> children;
-
-    Node(const Symbol& symbol, Node* previousNode)
-        : symbol(symbol), previousNode(previousNode) {}
-    explicit Node(const Symbol& symbol) : Node(symbol, nullptr) {}
+  // Indexed by nonterminal and by terminal
+  std::vector<Lexer::CandidateSet> nonTerminalCandidateList;
+  std::vector<Lexer::CandidateSet> terminalCandidateList;
+  // Built by the first tokenize()
+  std::optional<Lexer::TokenizeTable> tokenizeTable;
+
+  Token currentToken;
+  // Set by pretokenize()
+  std::optional<TokenBuffer> tokenBuffer;
+  size_t tokenIndex = 0;
+  Token eofToken;
+
+  // Of the last parse
+  ParseTree::Statistics parseTreeStatistics;
+
+  // Expected terminals of every symbol, so the lexer never builds them
+  void buildCandidateList() {
+    nonTerminalCandidateList.resize(table.getNonTerminalCount());
+    for (size_t nonTerminal = 0; nonTerminal < nonTerminalCandidateList.size();
+         nonTerminal++)
+      nonTerminalCandidateList[nonTerminal] =
+          lexer->createCandidateSet(table.getCandidate(nonTerminal));
+    for (size_t terminal = 0; terminal < lexer->getTerminalCount(); terminal++)
+      terminalCandidateList.push_back(
+          lexer->createCandidateSet(std::vector<size_t>{terminal}));
+  }
 
-    bool operator==(const Node& another) const {
-      return symbol == another.symbol;
+  // Read the token expected by a symbol on the top of the stack
+  void readNextToken(const Symbol& symbol) {
+    if (tokenBuffer) {
+      currentToken = tokenIndex < tokenBuffer->size()
+                         ? (*tokenBuffer)[tokenIndex++]
+                         : eofToken;
+      return;
+    }
+    switch (symbol.type) {
+      case Symbol::NonTerminal:
+        lexer->readNextTokenExpect(
+            nonTerminalCandidateList[symbol.getNonTerminal()]);
+        break;
+      case Symbol::Terminal:
+        lexer->readNextTokenExpect(
+            terminalCandidateList.at(symbol.getTerminal()));
+        break;
+      default:
+        lexer->readNextTokenExpectEof();
+        break;
     }
+    currentToken = lexer->getCurrentToken();
+  }
 
-    bool operator!=(const Node& another) const {
-      return symbol != another.symbol;
+  // Expected terminals of a token by the terminal before it
+  void buildTokenizeTable() {
+    const size_t terminalCount = lexer->getTerminalCount();
+    Lexer::TokenizeTable result;
+    std::vector<std::vector<bool>> isExpectedList;
+    auto add = [&](const std::vector<bool>& isExpected) -> size_t {
+      auto it = std::ranges::find(isExpectedList, isExpected);
+      if (it != isExpectedList.end())
+        return std::distance(isExpectedList.begin(), it);
+      isExpectedList.push_back(isExpected);
+      result.candidateSetList.push_back(lexer->createCandidateSet(
+          std::views::iota(size_t{0}, terminalCount) |
+          std::views::filter([&isExpected](size_t terminal) {
+            return isExpected[terminal];
+          })));
+      return isExpectedList.size() - 1;
+    };
+
+    std::vector<bool> isStartExpected(terminalCount);
+    for (const size_t& terminal : table.getCandidate(table.getStart()))
+      isStartExpected[terminal] = true;
+    result.start = add(isStartExpected);
+    // A chunk can start after any terminal
+    std::vector<bool> isGuessExpected(terminalCount);
+    for (const auto& isExpected : table.getFollowList(terminalCount)) {
+      result.followList.push_back(add(isExpected));
+      for (size_t terminal = 0; terminal < terminalCount; terminal++)
+        if (isExpected[terminal]) isGuessExpected[terminal] = true;
     }
-  };
+    result.guess = add(isGuessExpected);
+    tokenizeTable = std::move(result);
+  }
 
  public:
   explicit Parser(std::unique_ptr<Lexer> lexer,
                   Serializer::BinaryDeserializer deserializer)
       : lexer(std::move(lexer)) {
-    deserializer.deserialize(this->lexer->matcherList);
-    deserializer.deserialize(table.start);
-    deserializer.deserialize(table.table);
+    this->lexer->deserialize(deserializer);
+    deserializer.deserialize(table);
+    buildCandidateList();
+  }
+
+  [[nodiscard]] std::string_view getText(const ParseTree::Node& node) const {
+    return lexer->getText(node.getSpan());
+  }
+
+  [[nodiscard]] Position getPosition(const ParseTree::Node& node) const {
+    return lexer->getPosition(node.offset);
+  }
+
+  [[nodiscard]] const ParseTree::Statistics& getParseTreeStatistics() const {
+    return parseTreeStatistics;
+  }
+
+  // Error at the current token
+  [[nodiscard]] SyntaxError createSyntaxError(const std::string& message) {
+    return lexer->createSyntaxError(message, currentToken.span.offset);
+  }
+
+  /**
+   * Lex the whole input without parsing it. A token is expected by the
+   * terminal before it, as given by the grammar.
+   *
+   * @param  threadCount  : The input is lexed in parallel if it is more than 1
+   * @param  minChunkSize : See Lexer::tokenize()
+   */
+  [[nodiscard]] TokenBuffer tokenize(
+      size_t threadCount = 1, size_t minChunkSize = Lexer::MIN_CHUNK_SIZE) {
+    if (!tokenizeTable) buildTokenizeTable();
+    return lexer->tokenize(*tokenizeTable, threadCount, minChunkSize);
+  }
+
+  /**
+   * Tokenize an edited source again, where only the tokens around the edit
+   * are lexed. See Lexer::relex().
+   *
+   * @param  source      : The whole source after the edit, which replaces the
+   * input. It must outlive the parser.
+   * @param  tokenBuffer : Tokens of the source before the edit
+   */
+  TokenChange retokenize(std::string_view source, TokenBuffer& tokenBuffer,
+                         const TextEdit& edit) {
+    if (!tokenizeTable) buildTokenizeTable();
+    lexer->reset(source);
+    return lexer->relex(*tokenizeTable, tokenBuffer, edit);
+  }
+
+  /**
+   * Tokenize the whole input before parsing, and the parser only goes
+   * through the tokens. Lexing and parsing can then be measured apart.
+   *
+   * @param  threadCount  : See tokenize()
+   */
+  void pretokenize(size_t threadCount = 1) {
+    tokenBuffer = tokenize(threadCount);
+    tokenIndex = 0;
+    eofToken = lexer->getCurrentToken();
   }
 
   [[nodiscard]] virtual inline bool isEof(const Token& token) const {
     return token.type == Eof;
   }
 
-  Node parseExpression() noexcept(false) {
-    // Construct tree
-    std::list<Node*> epsilonNodeList;
-    Node root{Symbol::createNonTerminal(table.getStart())};
-    Node end{GeneratedLLTable::END};
-    std::stack<Node*> stack({&end, &root});
-    const Token& currentToken = lexer->getCurrentToken();
-    lexer->readNextTokenExpect(
-        table.getCandidate(root.symbol.getNonTerminal()));
+  ParseTree parseExpression() noexcept(false) {
+    ParseTree tree(Symbol::createNonTerminal(table.getStart()));
+    // Indices of the nodes to match, with END at the bottom
+    constexpr uint32_t END_NODE = std::numeric_limits<uint32_t>::max();
+    std::vector<uint32_t> stack{END_NODE, ParseTree::ROOT};
+    auto getSymbol = [&tree](uint32_t index) {
+      return index == END_NODE ? GeneratedLLTable::END : tree[index].symbol;
+    };
+    readNextToken(tree.getRoot().symbol);
     while (!stack.empty()) {
-      Node& currentNode = *stack.top();
-      const Symbol& symbol = isEof(currentToken)
-                                 ? GeneratedLLTable::END
-                                 : Symbol::createTerminal(currentToken.type);
-
-      if (currentNode.symbol.type != Symbol::NonTerminal) {
-        if (currentNode.symbol == symbol) {
-          currentNode.value = currentToken.value;
-          stack.pop();
+      const uint32_t index = stack.back();
+      const Symbol nodeSymbol = getSymbol(index);
+      const Symbol symbol = isEof(currentToken)
+                                ? GeneratedLLTable::END
+                                : Symbol::createTerminal(currentToken.type);
+
+      if (nodeSymbol.type != Symbol::NonTerminal) {
+        if (nodeSymbol == symbol) {
+          if (index != END_NODE) tree.setSpan(index, currentToken.span);
+          stack.pop_back();
           if (!isEof(currentToken)) {
-            if (!stack.empty()) {
-              const auto& currentSymbol = stack.top()->symbol;
-              if (currentSymbol.type == Symbol::NonTerminal)
-                lexer->readNextTokenExpect(
-                    table.getCandidate(currentSymbol.getNonTerminal()));
-              else if (currentSymbol.type == Symbol::Terminal)
-                lexer->readNextTokenExpect(
-                    std::list{currentSymbol.getTerminal()});
-              else
-                lexer->readNextTokenExpectEof();
-            } else
-              throw std::runtime_error("Extra token");
+            if (!stack.empty())
+              readNextToken(getSymbol(stack.back()));
+            else
+              throw createSyntaxError("Extra token");
           }
           continue;
         }
-        throw std::runtime_error("Unexpected token");
+        throw createSyntaxError("Unexpected token");
       }
 
-      const std::list<Symbol>& children =
-          table.predict(currentNode.symbol, symbol);
-      stack.pop();
+      const auto children = table.findPrediction(nodeSymbol, symbol);
+      if (children.empty()) throw createSyntaxError("No match prediction");
+      stack.pop_back();
+      // An empty production adds no child
       if (children.front().type != Symbol::End) {
-        for (const auto& symbol : children) {
-          currentNode.children.emplace_back(symbol, &currentNode);
-        }
-        for (auto& it : std::ranges::reverse_view(currentNode.children)) {
-          stack.push(&it);
-        }
-      } else
-        epsilonNodeList.push_back(&currentNode);
-    }
-
-    // Remove epsilon node
-    for (Node* node : epsilonNodeList) {
-      do {
-        Node* previousNode = node->previousNode;
-        previousNode->children.remove(*node);
-        node = previousNode;
-      } while (node != nullptr && node->children.empty());
+        const uint32_t first = tree.addChildren(index, children);
+        for (auto i = static_cast<uint32_t>(children.size()); i-- > 0;)
+          stack.push_back(first + i);
+      }
     }
-
-    return root;
+    tree.removeEmpty();
+    // The EOF token is at the end of the source
+    tree.setSourceSize(currentToken.span.offset);
+    parseTreeStatistics = tree.getStatistics();
+    return tree;
   };
 };
 }  // namespace GeneratedParser
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <string_view>
+#include <vector>
+
+#include "Serializer.parser.hpp"
+#include "Utility.parser.hpp"
+
+namespace GeneratedParser {
+/*
+ * Perfect hash over strings, found by the generator. No two keys share a
+ * slot, so a lookup is one hash and one comparison.
+ */
+struct PerfectHash {
+  static constexpr inline uint32_t NOT_FOUND =
+      std::numeric_limits<uint32_t>::max();
+
+  uint64_t multiplier = 0;
+  // 64 - log2(slot count)
+  uint32_t shift = 63;
+  // Indexed by slot
+  std::vector<std::string_view> keyList;
+  std::vector<uint32_t> valueList;
+
+  [[nodiscard]] size_t getSlot(std::string_view key) const {
+    return (Utility::hash(key) * multiplier) >> shift;
+  }
+
+  /**
+   * @return {uint32_t}  : The value of the key, or NOT_FOUND
+   */
+  [[nodiscard]] uint32_t find(std::string_view key) const {
+    if (valueList.empty()) return NOT_FOUND;
+    size_t slot = getSlot(key);
+    return keyList[slot] == key ? valueList[slot] : NOT_FOUND;
+  }
+};
+
+template <>
+class Serializer::Serializer<PerfectHash> : public ISerializer {
+ protected:
+  PerfectHash& perfectHash;
+
+ public:
+  explicit Serializer(PerfectHash& perfectHash) : perfectHash(perfectHash) {}
+  explicit Serializer(const PerfectHash& perfectHash)
+      : perfectHash(const_cast<PerfectHash&>(perfectHash)) {}
+
+  void serialize(BinaryOfStream& os) const override {
+    os.write(reinterpret_cast<const char*>(&perfectHash.multiplier),
+             sizeof(perfectHash.multiplier));
+    os.write(reinterpret_cast<const char*>(&perfectHash.shift),
+             sizeof(perfectHash.shift));
+    Serializer<size_t>(perfectHash.valueList.size()).serialize(os);
+    for (size_t slot = 0; slot < perfectHash.valueList.size(); slot++) {
+      Serializer<std::string_view>(perfectHash.keyList[slot]).serialize(os);
+      os.write(reinterpret_cast<const char*>(&perfectHash.valueList[slot]),
+               sizeof(uint32_t));
+    }
+  }
+
+  void deserialize(BinaryIfStream& stream) override {
+    perfectHash.multiplier = stream.read<uint64_t>();
+    perfectHash.shift = stream.read<uint32_t>();
+    size_t size = 0;
+    Serializer<size_t>(size).deserialize(stream);
+    perfectHash.keyList.resize(size);
+    perfectHash.valueList.resize(size);
+    for (size_t slot = 0; slot < size; slot++) {
+      Serializer<std::string_view>(perfectHash.keyList[slot])
+          .deserialize(stream);
+      perfectHash.valueList[slot] = stream.read<uint32_t>();
+    }
+  }
+};
+}  // namespace GeneratedParser
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "Scanner.parser.hpp"
+
+namespace GeneratedParser {
+// Both start from 1. The column counts bytes.
+struct Position {
+  size_t line = 1;
+  size_t column = 1;
+
+  [[nodiscard]] std::string toString() const {
+    return std::to_string(line) + ":" + std::to_string(column);
+  }
+};
+
+/*
+ * Offsets of the line starts in a source. It is only built when a position
+ * is asked for, so tracking positions costs nothing while lexing.
+ */
+class LineIndex {
+ protected:
+  std::vector<size_t> lineStartList{0};
+  size_t scannedSize = 0;
+
+ public:
+  // Scan the part of the source which is not scanned yet
+  void extend(std::string_view source) {
+    while (scannedSize < source.size()) {
+      size_t pos =
+          scannedSize + Scanner::findByte(source.substr(scannedSize), '\n');
+      if (pos == source.size()) {
+        scannedSize = pos;
+        break;
+      }
+      lineStartList.push_back(pos + 1);
+      scannedSize = pos + 1;
+    }
+  }
+
+  [[nodiscard]] Position getPosition(size_t offset) const {
+    auto it =
+        std::upper_bound(lineStartList.begin(), lineStartList.end(), offset);
+    size_t line = it - lineStartList.begin();
+    return {line, offset - lineStartList[line - 1] + 1};
+  }
+};
+
+struct SyntaxError : public std::runtime_error {
+ public:
+  const size_t offset;
+  const Position position;
+
+  SyntaxError(const std::string& message, size_t offset, Position position)
+      : std::runtime_error(message + " at " + position.toString()),
+        offset(offset),
+        position(position) {}
+};
+}  // namespace GeneratedParser
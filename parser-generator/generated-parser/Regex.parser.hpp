@@ -1,18 +1,31 @@
 #pragma once
 
 #include <algorithm>
+#include <array>
+#include <atomic>
 #include <exception>
 #include <functional>
 #include <istream>
 #include <iterator>
+#include <limits>
 #include <list>
+#include <map>
 #include <memory>
+#include <mutex>
+#include <optional>
+#include <set>
+#include <shared_mutex>
+#include <span>
 #include <stack>
 #include <stdexcept>
 #include <string>
-#include <unordered_set>
+#include <unordered_map>
 #include <utility>
+#include <vector>
 
+#include "ByteSet.parser.hpp"
+#include "Scanner.parser.hpp"
+#include "Unicode.parser.hpp"
 #include "Utility.parser.hpp"
 
 namespace GeneratedParser {
@@ -22,7 +35,7 @@ class Regex {
   struct Container;
 
  protected:
-  using Stream = Utility::ForwardBufferedInputStream;
+  using Stream = Utility::ChunkedInputStream;
 
   struct ContainerStack {
    protected:
@@ -85,47 +98,81 @@ class Regex {
   };
 
  public:
-  struct Controller {
-    [[nodiscard]] virtual char peek() = 0;
-    virtual char get() = 0;
-    virtual void consume() = 0;
+  struct Condition;
 
-    [[nodiscard]] virtual size_t record() const = 0;
-    virtual void restore(size_t index) = 0;
-
-    auto derive() { return DerivedController(*this); }
+  // Thrown when a match takes more steps than the budget of the regex
+  struct StepBudgetException : public std::runtime_error {
+   public:
+    explicit StepBudgetException(size_t position)
+        : std::runtime_error("Regex step budget exceeded at " +
+                             std::to_string(position)) {}
   };
 
-  struct DerivedController : Controller {
+  /*
+   * State of one call to match(), shared with the lookaheads inside it. A
+   * step is one char read by the automaton, or one pair of a state and a
+   * position searched by a lookahead. Neither depends on what the lazy DFA
+   * has cached, so a match spends the same steps whatever ran before it.
+   */
+  class MatchContext {
    protected:
-    Controller& controller;
-    const size_t startPos;
+    size_t remainingStepCount;
+    // Whether a lookahead body reaches a final state from a pair of a state
+    // and a position, see FlatNFA::getPair()
+    std::unordered_map<size_t, bool> lookaheadMap;
 
    public:
-    explicit DerivedController(Controller& controller)
-        : controller(controller), startPos(controller.record()) {}
+    explicit MatchContext(size_t stepBudget)
+        : remainingStepCount(stepBudget) {}
 
-    ~DerivedController() { controller.restore(startPos); }
+    void spend(size_t stepCount, size_t position) {
+      if (stepCount > remainingStepCount)
+        throw StepBudgetException(position);
+      remainingStepCount -= stepCount;
+    }
 
-    [[nodiscard]] char peek() override { return controller.peek(); }
+    [[nodiscard]] std::optional<bool> findLookahead(size_t pair) const {
+      const auto it = lookaheadMap.find(pair);
+      if (it == lookaheadMap.end()) return std::nullopt;
+      return it->second;
+    }
 
-    char get() override { return controller.get(); }
+    void addLookahead(size_t pair, bool isMatched) {
+      lookaheadMap.emplace(pair, isMatched);
+    }
+  };
 
-    void consume() override { return controller.consume(); }
+  /*
+   * Input of the matcher. The matchers are templates over the final
+   * controllers below, so these calls are resolved statically and inlined.
+   * Only a condition which reads more than one char goes through the virtual
+   * calls.
+   */
+  struct Controller {
+    // nullptr if the match has no budget, e.g. from the generator
+    MatchContext* context = nullptr;
 
-    [[nodiscard]] size_t record() const override { return controller.record(); }
+    explicit Controller(MatchContext* context = nullptr) : context(context) {}
 
-    void restore(size_t index) override { return controller.restore(index); }
+    void spend(size_t stepCount) {
+      if (context != nullptr) context->spend(stepCount, record());
+    }
 
-    auto derive() { return DerivedController(controller); }
+    [[nodiscard]] virtual char peek() = 0;
+    virtual char get() = 0;
+    virtual void consume() = 0;
+
+    [[nodiscard]] virtual size_t record() const = 0;
+    virtual void restore(size_t index) = 0;
   };
 
-  struct StreamController : Controller {
+  struct StreamController final : Controller {
    protected:
     Stream& stream;
 
    public:
-    explicit StreamController(Stream& stream) : stream(stream){};
+    explicit StreamController(Stream& stream, MatchContext* context = nullptr)
+        : Controller(context), stream(stream){};
 
     [[nodiscard]] char peek() override {
       return static_cast<char>(stream.peek());
@@ -140,17 +187,19 @@ class Regex {
     void restore(size_t index) override { stream.seekg(index); }
   };
 
-  struct StringController : Controller {
+  struct StringController final : Controller {
    protected:
     std::string_view str;
     size_t index = 0;
 
    public:
-    explicit StringController(std::string_view str) : str(str){};
+    explicit StringController(std::string_view str,
+                              MatchContext* context = nullptr)
+        : Controller(context), str(str){};
 
     [[nodiscard]] char peek() override {
       if (index >= str.size()) return EOF;
-      return str.at(index);
+      return str[index];
     }
 
     char get() override {
@@ -166,6 +215,7 @@ class Regex {
     void restore(size_t index) override { this->index = index; }
   };
 
+  struct Condition;
   struct Transition;
   struct State {
     friend struct Transition;
@@ -178,16 +228,8 @@ class Regex {
       transitionList.push_back(std::move(transition));
     };
 
-    void accept(DerivedController controller,
-                std::unordered_set<const State*>& stateSet) const {
-      for (const auto& transition : transitionList) {
-        if (transition.condition) {
-          if (transition.condition->operator()(controller.derive()))
-            stateSet.insert(transition.state);
-        } else {
-          transition.state->accept(controller, stateSet);
-        }
-      }
+    [[nodiscard]] const std::list<Transition>& getTransitionList() const {
+      return transitionList;
     }
 
     [[nodiscard]] bool isMatched() const {
@@ -202,6 +244,383 @@ class Regex {
 
   std::list<State> stateList;
 
+  /*
+   * The NFA compacted into arrays after parse(). States are indexed from 0,
+   * the start state, and epsilon transitions are followed once here instead
+   * of on every step: a state keeps every transition with a condition in its
+   * epsilon closure, and whether the closure reaches a final state.
+   *
+   * A single-char condition is compiled to a ByteSet, so testing it is one
+   * bit probe.
+   *
+   * The body of a lookahead is part of the same arrays, from its own start
+   * state. A lookahead reads no char: it is followed like an epsilon
+   * transition, and the edges and final states behind it keep it as a guard,
+   * which has to hold at the position they are tested at.
+   */
+  class FlatNFA {
+   public:
+    static constexpr inline uint32_t START_STATE = 0;
+    // Guard of the edges without any lookahead
+    static constexpr inline uint32_t NO_GUARD = 0;
+
+    struct Lookahead {
+      uint32_t startState;
+      bool isInverted;
+    };
+
+    struct Edge {
+      // Only for a condition which reads more than one char, or nullptr
+      const Condition* condition;
+      // Bytes accepted if there is no condition
+      ByteSet byteSet;
+      uint32_t state;
+      // Lookaheads which have to hold before the char
+      uint32_t guard;
+
+      [[nodiscard]] bool isSingleChar() const { return condition == nullptr; }
+    };
+
+   protected:
+    // Edges of state i are edgeList[edgeStartList[i], edgeStartList[i + 1])
+    std::vector<Edge> edgeList;
+    std::vector<uint32_t> edgeStartList;
+    std::vector<bool> matchedList;
+    // Guards under which state i is final, same layout as the edges
+    std::vector<uint32_t> matchGuardList;
+    std::vector<uint32_t> matchGuardStartList;
+    std::vector<Lookahead> lookaheadList;
+    // Indices in lookaheadList, sorted
+    std::vector<std::vector<uint32_t>> guardList{{}};
+
+   public:
+    explicit FlatNFA(const std::list<State>& stateList) {
+      std::unordered_map<const State*, uint32_t> indexMap;
+      for (const auto& state : stateList)
+        indexMap.emplace(&state, static_cast<uint32_t>(indexMap.size()));
+      std::unordered_map<const Condition*, uint32_t> lookaheadMap;
+      for (const auto& state : stateList)
+        for (const auto& transition : state.getTransitionList())
+          if (const auto* lookahead = dynamic_cast<const LookaheadCondition*>(
+                  transition.condition.get())) {
+            lookaheadMap.emplace(lookahead,
+                                 static_cast<uint32_t>(lookaheadList.size()));
+            lookaheadList.push_back(
+                {indexMap.at(lookahead->startState), lookahead->isInverted});
+          }
+      std::map<std::vector<uint32_t>, uint32_t> guardMap{{{}, NO_GUARD}};
+      const auto addLookahead = [this, &guardMap](uint32_t guard,
+                                                  uint32_t lookahead) {
+        std::vector<uint32_t> lookaheadSet = guardList[guard];
+        const auto it = std::ranges::lower_bound(lookaheadSet, lookahead);
+        if (it != lookaheadSet.end() && *it == lookahead) return guard;
+        lookaheadSet.insert(it, lookahead);
+        const auto [guardIt, isCreated] = guardMap.emplace(
+            lookaheadSet, static_cast<uint32_t>(guardList.size()));
+        if (isCreated) guardList.push_back(std::move(lookaheadSet));
+        return guardIt->second;
+      };
+      const size_t size = stateList.size();
+      edgeStartList.reserve(size + 1);
+      matchedList.resize(size);
+      // Epsilon closure of the current state, with the guard of each path
+      std::set<std::pair<uint32_t, uint32_t>> closure;
+      std::vector<std::pair<const State*, uint32_t>> stack;
+      for (const auto& state : stateList) {
+        const uint32_t index = indexMap.at(&state);
+        closure = {{index, NO_GUARD}};
+        edgeStartList.push_back(static_cast<uint32_t>(edgeList.size()));
+        matchGuardStartList.push_back(
+            static_cast<uint32_t>(matchGuardList.size()));
+        stack.emplace_back(&state, NO_GUARD);
+        while (!stack.empty()) {
+          const auto [current, guard] = stack.back();
+          stack.pop_back();
+          // Same as State::isMatched()
+          if (current->getTransitionList().empty()) {
+            if (guard == NO_GUARD)
+              matchedList[index] = true;
+            else
+              matchGuardList.push_back(guard);
+          }
+          for (const auto& transition : current->getTransitionList()) {
+            const uint32_t target = indexMap.at(transition.state);
+            uint32_t targetGuard = guard;
+            if (const auto it = lookaheadMap.find(transition.condition.get());
+                it != lookaheadMap.end())
+              targetGuard = addLookahead(guard, it->second);
+            else if (transition.condition) {
+              addEdge(*transition.condition, target, guard);
+              continue;
+            }
+            if (closure.emplace(target, targetGuard).second)
+              stack.emplace_back(transition.state, targetGuard);
+          }
+        }
+      }
+      edgeStartList.push_back(static_cast<uint32_t>(edgeList.size()));
+      matchGuardStartList.push_back(
+          static_cast<uint32_t>(matchGuardList.size()));
+    }
+
+    [[nodiscard]] size_t size() const { return matchedList.size(); }
+
+   protected:
+    void addEdge(const Condition& condition, uint32_t target, uint32_t guard) {
+      if (condition.isSingleChar())
+        edgeList.push_back({nullptr, ByteSetCondition::createByteSet(condition),
+                            target, guard});
+      else
+        edgeList.push_back({&condition, {}, target, guard});
+    }
+
+   public:
+    // Whether the state is final without any lookahead
+    [[nodiscard]] bool isMatched(uint32_t state) const {
+      return matchedList[state];
+    }
+
+    // Guards under which the state is final as well
+    [[nodiscard]] std::span<const uint32_t> getMatchGuardList(
+        uint32_t state) const {
+      return {matchGuardList.data() + matchGuardStartList[state],
+              matchGuardList.data() + matchGuardStartList[state + 1]};
+    }
+
+    [[nodiscard]] std::span<const Edge> getEdgeList(uint32_t state) const {
+      return {edgeList.data() + edgeStartList[state],
+              edgeList.data() + edgeStartList[state + 1]};
+    }
+
+   protected:
+    struct SearchFrame {
+      uint32_t state;
+      size_t position;
+      // Next final guard or edge of the state to try
+      size_t index;
+    };
+
+    [[nodiscard]] size_t getPair(uint32_t state, size_t position) const {
+      return position * size() + state;
+    }
+
+    /**
+     * @param  frame : Set to the pair to search first, if the guard waits for
+     * a lookahead which is not searched yet
+     * @return {std::optional<bool>}  : Whether the guard holds
+     */
+    [[nodiscard]] std::optional<bool> findGuard(
+        uint32_t guard, size_t position, const MatchContext& context,
+        std::optional<SearchFrame>& frame) const {
+      for (const uint32_t lookahead : guardList[guard]) {
+        const uint32_t startState = lookaheadList[lookahead].startState;
+        const auto isMatched =
+            context.findLookahead(getPair(startState, position));
+        if (!isMatched) {
+          frame = {startState, position, 0};
+          return std::nullopt;
+        }
+        if (*isMatched == lookaheadList[lookahead].isInverted) return false;
+      }
+      return true;
+    }
+
+    /**
+     * Find whether the pair reaches a final state, depth first, and keep the
+     * result of every pair searched on the way in the context.
+     */
+    template <class Input>
+    void search(SearchFrame startFrame, Input& controller,
+                MatchContext& context) const {
+      std::vector<SearchFrame> stack{startFrame};
+      controller.spend(1);
+      while (!stack.empty()) {
+        SearchFrame& frame = stack.back();
+        const auto matchGuardList = getMatchGuardList(frame.state);
+        const auto edgeList = getEdgeList(frame.state);
+        bool isMatched = matchedList[frame.state];
+        std::optional<SearchFrame> nextFrame;
+        for (; !isMatched &&
+               frame.index < matchGuardList.size() + edgeList.size();
+             frame.index++) {
+          const bool isEdge = frame.index >= matchGuardList.size();
+          const Edge* edge =
+              isEdge ? &edgeList[frame.index - matchGuardList.size()] : nullptr;
+          const auto isHeld =
+              findGuard(isEdge ? edge->guard : matchGuardList[frame.index],
+                        frame.position, context, nextFrame);
+          if (!isHeld) break;
+          if (!*isHeld) continue;
+          if (!isEdge) {
+            isMatched = true;
+            break;
+          }
+          controller.restore(frame.position);
+          if (controller.peek() == EOF) continue;
+          const bool isAccepted =
+              edge->isSingleChar()
+                  ? edge->byteSet[static_cast<unsigned char>(controller.peek())]
+                  : edge->condition->operator()(
+                        static_cast<Controller&>(controller));
+          if (!isAccepted) continue;
+          const auto isNextMatched =
+              context.findLookahead(getPair(edge->state, frame.position + 1));
+          if (!isNextMatched) {
+            nextFrame = {edge->state, frame.position + 1, 0};
+            break;
+          }
+          isMatched = *isNextMatched;
+        }
+        if (nextFrame) {
+          // The frame is tried again from the same index once it is known
+          stack.push_back(*nextFrame);
+          controller.spend(1);
+          continue;
+        }
+        context.addLookahead(getPair(frame.state, frame.position), isMatched);
+        stack.pop_back();
+      }
+    }
+
+   public:
+    /**
+     * Whether the body of the lookahead matches from the current position,
+     * which is restored after.
+     *
+     * The body is searched depth first over pairs of a state and a position,
+     * and whether a pair reaches a final state is kept in the context. A pair
+     * is only searched once in a whole match, however many positions and
+     * enclosing lookaheads reach it, so every lookahead of a match takes
+     * O(n * m) steps in all, for n chars and m states.
+     */
+    template <class Input>
+    [[nodiscard]] bool isLookaheadHeld(uint32_t lookahead,
+                                       Input& controller) const {
+      const size_t position = controller.record();
+      const uint32_t startState = lookaheadList[lookahead].startState;
+      // Without a context, the pairs are only kept for this lookahead
+      MatchContext localContext(std::numeric_limits<size_t>::max());
+      MatchContext& context =
+          controller.context != nullptr ? *controller.context : localContext;
+      auto isMatched = context.findLookahead(getPair(startState, position));
+      if (!isMatched) {
+        search({startState, position, 0}, controller, context);
+        isMatched = context.findLookahead(getPair(startState, position));
+        controller.restore(position);
+      }
+      return lookaheadList[lookahead].isInverted != *isMatched;
+    }
+
+    template <class Input>
+    [[nodiscard]] bool isGuardHeld(uint32_t guard, Input& controller) const {
+      return std::ranges::all_of(
+          guardList[guard], [this, &controller](uint32_t lookahead) {
+            return isLookaheadHeld(lookahead, controller);
+          });
+    }
+
+    // Whether the state is final at the current position
+    template <class Input>
+    [[nodiscard]] bool isMatched(uint32_t state, Input& controller) const {
+      return matchedList[state] ||
+             std::ranges::any_of(getMatchGuardList(state),
+                                 [this, &controller](uint32_t guard) {
+                                   return isGuardHeld(guard, controller);
+                                 });
+    }
+
+    template <class Input>
+    [[nodiscard]] bool isAnyMatched(const Utility::SparseSet& stateSet,
+                                    Input& controller) const {
+      return std::ranges::any_of(stateSet,
+                                 [this, &controller](uint32_t state) {
+                                   return isMatched(state, controller);
+                                 });
+    }
+
+    // Add the states after the current char to nextSet
+    template <class Input>
+    void step(const Utility::SparseSet& currentSet, Input& controller,
+              Utility::SparseSet& nextSet) const {
+      const auto ch = static_cast<unsigned char>(controller.peek());
+      const size_t pos = controller.record();
+      for (const uint32_t state : currentSet)
+        for (const Edge& edge : getEdgeList(state)) {
+          if (edge.guard != NO_GUARD && !isGuardHeld(edge.guard, controller))
+            continue;
+          bool isAccepted = false;
+          if (edge.isSingleChar()) {
+            isAccepted = edge.byteSet[ch];
+          } else {
+            isAccepted = edge.condition->operator()(
+                static_cast<Controller&>(controller));
+            controller.restore(pos);
+          }
+          if (isAccepted) nextSet.insert(edge.state);
+        }
+    }
+
+    /**
+     * Continue a match with the states at the current position, after a
+     * char is read.
+     *
+     * @param  lastMatchedIndex : End of the longest match so far, or -1
+     */
+    template <class Input>
+    [[nodiscard]] bool resume(Utility::SparseSet& currentSet,
+                              Input& controller, bool isGreedy,
+                              int lastMatchedIndex) const {
+      Utility::SparseSet nextSet(size());
+      while (!currentSet.empty()) {
+        if (isAnyMatched(currentSet, controller)) {
+          if (!isGreedy) return true;
+          lastMatchedIndex = static_cast<int>(controller.record());
+        }
+        if (controller.peek() == EOF) break;
+        controller.spend(1);
+        step(currentSet, controller, nextSet);
+        controller.consume();
+        std::swap(currentSet, nextSet);
+        nextSet.clear();
+      }
+      if (isGreedy && lastMatchedIndex >= 0) {
+        controller.restore(lastMatchedIndex);
+        return true;
+      }
+      return false;
+    }
+
+    /**
+     * Same as resume(), but the states at the current position are already
+     * tested for a match.
+     */
+    template <class Input>
+    [[nodiscard]] bool match(Utility::SparseSet& currentSet, Input& controller,
+                             bool isGreedy, int lastMatchedIndex) const {
+      if (controller.peek() != EOF) {
+        Utility::SparseSet nextSet(size());
+        controller.spend(1);
+        step(currentSet, controller, nextSet);
+        controller.consume();
+        return resume(nextSet, controller, isGreedy, lastMatchedIndex);
+      }
+      if (isGreedy && lastMatchedIndex >= 0) {
+        controller.restore(lastMatchedIndex);
+        return true;
+      }
+      return false;
+    }
+
+    template <class Input>
+    [[nodiscard]] bool match(Input& controller, bool isGreedy) const {
+      Utility::SparseSet currentSet(size());
+      currentSet.insert(START_STATE);
+      if (isGreedy) return resume(currentSet, controller, true, -1);
+      // Not greedy, the empty string is not a match
+      return match(currentSet, controller, false, -1);
+    }
+  };
+
  protected:
   bool _isGreedy = true;
 
@@ -210,24 +629,341 @@ class Regex {
     return stateList.back();
   }
 
+  /*
+   * DFA built from the NFA while matching, same as RE2 does. A DFA state is
+   * a set of NFA states, which is created the first time it is reached and
+   * cached. Once the cache is full, it is flushed and built again from the
+   * current set, at most once per match, after which the rest of the match
+   * is left to the NFA. The cache is shared by every thread matching the
+   * regex: a cached transition is read without any lock, and only a new one
+   * is added under the mutex. A match holds the cache lock shared while it
+   * reads the states, so they are only flushed when no match reads them.
+   */
+  class LazyDFA {
+   protected:
+    struct DFAState {
+      std::vector<uint32_t> stateSet;
+      bool isMatched = false;
+      // Whether every condition after the states only depends on the current
+      // char, and no lookahead is behind them, so a transition only depends
+      // on the char
+      bool isSingleChar = true;
+      // Indexed by byte, nullptr if not computed yet
+      mutable std::array<std::atomic<const DFAState*>, 256> nextList{};
+    };
+
+    const FlatNFA& nfa;
+    const size_t cacheSize;
+
+    std::shared_mutex cacheMutex;
+    // Matches which wait to flush, new matches skip the DFA meanwhile so
+    // they get the cache lock
+    std::atomic<size_t> flushingCount = 0;
+    // Guarded by cacheMutex, so a cache is flushed once when several
+    // matches find it full
+    size_t flushedCount = 0;
+    std::mutex mutex;
+    size_t usedSize = 0;
+    // States never move until the cache is flushed
+    std::list<DFAState> stateList;
+    std::map<std::vector<uint32_t>, const DFAState*> stateMap;
+    // No NFA state is left
+    const DFAState deadState;
+    const DFAState* startState = nullptr;
+
+    /**
+     * The mutex must be held.
+     *
+     * @param  stateSet : Sorted
+     * @return {const DFAState*}  : nullptr if the cache is full
+     */
+    const DFAState* findOrCreate(std::vector<uint32_t> stateSet) {
+      if (stateSet.empty()) return &deadState;
+      if (auto it = stateMap.find(stateSet); it != stateMap.end())
+        return it->second;
+      // The set is kept twice, in the state and in the map
+      const size_t size =
+          sizeof(DFAState) + 2 * stateSet.size() * sizeof(uint32_t);
+      if (usedSize + size > cacheSize) return nullptr;
+      usedSize += size;
+      DFAState& state = stateList.emplace_back();
+      state.stateSet = stateSet;
+      state.isMatched = std::ranges::any_of(
+          stateSet, [this](uint32_t state) { return nfa.isMatched(state); });
+      state.isSingleChar =
+          std::ranges::all_of(stateSet, [this](uint32_t state) {
+            return nfa.getMatchGuardList(state).empty() &&
+                   std::ranges::all_of(
+                       nfa.getEdgeList(state), [](const FlatNFA::Edge& edge) {
+                         return edge.isSingleChar() &&
+                                edge.guard == FlatNFA::NO_GUARD;
+                       });
+          });
+      stateMap.emplace(std::move(stateSet), &state);
+      return &state;
+    }
+
+    // @return {const DFAState*}  : nullptr if the cache is full
+    const DFAState* findOrCreate(const Utility::SparseSet& stateSet) {
+      std::vector<uint32_t> sortedSet(stateSet.begin(), stateSet.end());
+      std::ranges::sort(sortedSet);
+      std::lock_guard lock(mutex);
+      return findOrCreate(std::move(sortedSet));
+    }
+
+    [[nodiscard]] Utility::SparseSet toSparseSet(const DFAState& state) const {
+      Utility::SparseSet stateSet(nfa.size());
+      for (const uint32_t nfaState : state.stateSet) stateSet.insert(nfaState);
+      return stateSet;
+    }
+
+    /**
+     * @param  nextSet : Set to the NFA states after the current char, which
+     * are kept if the cache is full
+     * @return {const DFAState*}  : nullptr if the cache is full
+     */
+    template <class Input>
+    const DFAState* createNext(const DFAState& from, Input& controller,
+                               Utility::SparseSet& nextSet) {
+      const auto ch = static_cast<unsigned char>(controller.peek());
+      nfa.step(toSparseSet(from), controller, nextSet);
+      const DFAState* nextState = findOrCreate(nextSet);
+      if (nextState != nullptr)
+        from.nextList[ch].store(nextState, std::memory_order_release);
+      return nextState;
+    }
+
+    /**
+     * Drop every state, unless another match did since flushedCount was
+     * read. The cache lock must not be held.
+     */
+    void flush(size_t count) {
+      flushingCount++;
+      {
+        std::unique_lock cacheLock(cacheMutex);
+        if (flushedCount == count) {
+          flushedCount++;
+          std::lock_guard lock(mutex);
+          stateMap.clear();
+          stateList.clear();
+          usedSize = 0;
+          startState =
+              findOrCreate(std::vector<uint32_t>{FlatNFA::START_STATE});
+        }
+      }
+      flushingCount--;
+    }
+
+   public:
+    LazyDFA(const FlatNFA& nfa, size_t cacheSize)
+        : nfa(nfa), cacheSize(cacheSize) {
+      startState = findOrCreate(std::vector<uint32_t>{FlatNFA::START_STATE});
+    }
+
+    /**
+     * Same result as FlatNFA::match(). A state which does not only depend on
+     * the next char is left to the NFA once it is reached.
+     */
+    template <class Input>
+    bool match(Input& controller, bool isGreedy) {
+      if (flushingCount > 0) return nfa.match(controller, isGreedy);
+      std::shared_lock cacheLock(cacheMutex);
+      const DFAState* current = startState;
+      if (current == nullptr || !current->isSingleChar) {
+        cacheLock.unlock();
+        return nfa.match(controller, isGreedy);
+      }
+      int lastMatchedIndex = isGreedy && current->isMatched
+                                 ? static_cast<int>(controller.record())
+                                 : -1;
+      bool isFlushed = false;
+      while (controller.peek() != EOF) {
+        const auto ch = static_cast<unsigned char>(controller.peek());
+        const DFAState* next =
+            current->nextList[ch].load(std::memory_order_acquire);
+        if (next == nullptr) {
+          Utility::SparseSet nextSet(nfa.size());
+          next = createNext(*current, controller, nextSet);
+          if (next == nullptr && !isFlushed) {
+            const size_t count = flushedCount;
+            cacheLock.unlock();
+            flush(count);
+            cacheLock.lock();
+            isFlushed = true;
+            next = findOrCreate(nextSet);
+          }
+          // Still full, so the rest is left to the NFA
+          if (next == nullptr) {
+            cacheLock.unlock();
+            controller.spend(1);
+            controller.consume();
+            return nfa.resume(nextSet, controller, isGreedy, lastMatchedIndex);
+          }
+        }
+        controller.spend(1);
+        controller.consume();
+        current = next;
+        if (!current->isSingleChar) {
+          Utility::SparseSet currentSet = toSparseSet(*current);
+          cacheLock.unlock();
+          return nfa.resume(currentSet, controller, isGreedy, lastMatchedIndex);
+        }
+        if (isGreedy) {
+          if (current == &deadState) {
+            if (lastMatchedIndex >= 0) {
+              controller.restore(lastMatchedIndex);
+              return true;
+            }
+            return false;
+          }
+          if (current->isMatched)
+            lastMatchedIndex = static_cast<int>(controller.record());
+        } else {
+          if (current == &deadState) return false;
+          if (current->isMatched) return true;
+        }
+      }
+      if (isGreedy) {
+        if (lastMatchedIndex >= 0) {
+          controller.restore(lastMatchedIndex);
+          return true;
+        }
+        return current->isMatched;
+      }
+      return false;
+    }
+  };
+
+  /*
+   * What every match starts with, so find() can skip to the positions where
+   * a match can start with memchr() or SIMD, before running the automaton.
+   */
+  struct Prefilter {
+    static constexpr inline size_t MAX_PREFIX_SIZE = 16;
+
+    // Bytes every match starts with
+    std::string prefix;
+    // Bytes a match can start with
+    ByteSet firstByteSet;
+    // Whether the empty string matches, so every position matches
+    bool isEmptyMatched = false;
+
+    explicit Prefilter(const FlatNFA& nfa) {
+      Utility::SparseSet currentSet(nfa.size());
+      Utility::SparseSet nextSet(nfa.size());
+      currentSet.insert(FlatNFA::START_STATE);
+      isEmptyMatched = isAnyFinal(nfa, currentSet);
+      if (isEmptyMatched) return;
+      firstByteSet = getNextByteSet(nfa, currentSet);
+      // Follow the states while only one byte can be next
+      while (prefix.size() < MAX_PREFIX_SIZE &&
+             !isAnyFinal(nfa, currentSet)) {
+        const ByteSet byteSet = getNextByteSet(nfa, currentSet);
+        if (byteSet.count() != 1) break;
+        size_t byte = 0;
+        while (!byteSet[byte]) byte++;
+        prefix.push_back(static_cast<char>(byte));
+        for (const uint32_t state : currentSet)
+          for (const auto& edge : nfa.getEdgeList(state))
+            if (edge.byteSet[byte]) nextSet.insert(edge.state);
+        std::swap(currentSet, nextSet);
+        nextSet.clear();
+      }
+    }
+
+    // Whether a state is final behind some lookahead, or without any
+    static bool isAnyFinal(const FlatNFA& nfa,
+                           const Utility::SparseSet& stateSet) {
+      return std::ranges::any_of(stateSet, [&nfa](uint32_t state) {
+        return nfa.isMatched(state) || !nfa.getMatchGuardList(state).empty();
+      });
+    }
+
+    // @return {ByteSet}  : Every byte if a condition reads more than one char
+    static ByteSet getNextByteSet(const FlatNFA& nfa,
+                                  const Utility::SparseSet& stateSet) {
+      ByteSet byteSet;
+      for (const uint32_t state : stateSet)
+        for (const auto& edge : nfa.getEdgeList(state)) {
+          if (!edge.isSingleChar()) return ByteSet().set();
+          byteSet |= edge.byteSet;
+        }
+      return byteSet;
+    }
+
+    /**
+     * @return {size_t}  : The first position from pos where a match can
+     * start, or the size of str
+     */
+    [[nodiscard]] size_t findCandidate(std::string_view str,
+                                       size_t pos) const {
+      if (isEmptyMatched) return pos;
+      while (pos < str.size()) {
+        const std::string_view rest = str.substr(pos);
+        if (!prefix.empty()) {
+          pos += Scanner::findByte(rest, prefix.front());
+          if (pos + prefix.size() > str.size()) return str.size();
+          if (str.compare(pos, prefix.size(), prefix) == 0) return pos;
+          pos++;
+          continue;
+        }
+        switch (firstByteSet.count()) {
+          case 0:
+            return str.size();
+          case 2: {
+            size_t first = 0;
+            while (!firstByteSet[first]) first++;
+            size_t second = first + 1;
+            while (!firstByteSet[second]) second++;
+            return pos + Scanner::findEitherByte(rest, static_cast<char>(first),
+                                                 static_cast<char>(second));
+          }
+          default:
+            for (; pos < str.size(); pos++)
+              if (firstByteSet[static_cast<unsigned char>(str[pos])])
+                return pos;
+            return pos;
+        }
+      }
+      return str.size();
+    }
+  };
+
+  // Both are kept on the heap, so the reference from lazyDFA stays valid
+  std::unique_ptr<const FlatNFA> nfa;
+  std::unique_ptr<LazyDFA> lazyDFA;
+  std::unique_ptr<const Prefilter> prefilter;
+
+  size_t stepBudget = std::numeric_limits<size_t>::max();
+
  public:
-  explicit Regex(std::string_view regexStr) { parse(regexStr); };
+  // Memory of the lazy DFA, before it falls back to the NFA
+  static constexpr inline size_t DEFAULT_CACHE_SIZE = 1024 * 1024;
+
+  explicit Regex(std::string_view regexStr,
+                 size_t cacheSize = DEFAULT_CACHE_SIZE) {
+    parse(regexStr);
+    nfa = std::make_unique<const FlatNFA>(stateList);
+    lazyDFA = std::make_unique<LazyDFA>(*nfa, cacheSize);
+    prefilter = std::make_unique<const Prefilter>(*nfa);
+  };
 
   [[nodiscard]] const State& getStartState() const { return stateList.front(); }
 
+  [[nodiscard]] const FlatNFA& getFlatNFA() const { return *nfa; }
+
   [[nodiscard]] const bool& isGreedy() const { return _isGreedy; }
 
-  static bool isAnyStateMatch(
-      std::unordered_set<const Regex::State*> currentState) {
-    return std::find_if(currentState.begin(), currentState.end(),
-                        [](const State* state) {
-                          return state->isMatched();
-                        }) != currentState.end();
-  }
+  /**
+   * Limit the steps of every match(), so a bad input can not stall it. The
+   * match throws StepBudgetException once it is exceeded.
+   */
+  void setStepBudget(size_t stepBudget) { this->stepBudget = stepBudget; }
 
   [[nodiscard]] bool match(std::string_view str) const {
-    StringController controller(str);
-    return Regex::match(getStartState(), controller, _isGreedy);
+    MatchContext context(stepBudget);
+    StringController controller(str, &context);
+    return lazyDFA->match(controller, _isGreedy);
   }
 
   [[nodiscard]] bool match(std::istream& stdStream) const {
@@ -236,58 +972,53 @@ class Regex {
   }
 
   [[nodiscard]] bool match(Stream& stream) const {
-    StreamController controller(stream);
-    return Regex::match(getStartState(), controller, _isGreedy);
+    MatchContext context(stepBudget);
+    StreamController controller(stream, &context);
+    return lazyDFA->match(controller, _isGreedy);
   }
 
-  [[nodiscard]] static bool match(const State& startState,
-                                  Controller& controller,
-                                  bool isGreedy = true) {
-    std::unordered_set<const Regex::State*> currentSet{&startState};
-    std::unordered_set<const Regex::State*> nextSet{};
-    int lastMatchedIndex = isGreedy && isAnyStateMatch(currentSet)
-                               ? static_cast<int>(controller.record())
-                               : -1;
-    while (controller.peek() != EOF) {
-      for (const auto& state : currentSet) {
-        state->accept(controller.derive(), nextSet);
-      }
-      controller.consume();
-      currentSet = nextSet;
-      nextSet.clear();
-      if (isGreedy) {
-        if (currentSet.empty()) {
-          if (lastMatchedIndex >= 0) {
-            controller.restore(lastMatchedIndex);
-            return true;
-          }
-          return false;
-        }
-        if (isAnyStateMatch(currentSet)) {
-          lastMatchedIndex = static_cast<int>(controller.record());
-        }
-      } else {
-        if (currentSet.empty()) return false;
-        if (isAnyStateMatch(currentSet)) return true;
-      }
-    }
-    if (isGreedy) {
-      if (lastMatchedIndex >= 0) {
-        controller.restore(lastMatchedIndex);
-        return true;
-      }
-      return isAnyStateMatch(currentSet);
+  struct FindResult {
+    size_t start;
+    size_t end;
+  };
+
+  /**
+   * Find the first position from pos where the regex matches, same as
+   * match() there. Positions are skipped with the prefilter first. The step
+   * budget is shared by every position tried.
+   *
+   * @return {std::optional<FindResult>}  : Offsets in str
+   */
+  [[nodiscard]] std::optional<FindResult> find(std::string_view str,
+                                               size_t pos = 0) const {
+    MatchContext context(stepBudget);
+    StringController controller(str, &context);
+    for (; (pos = prefilter->findCandidate(str, pos)) <= str.size(); pos++) {
+      controller.restore(pos);
+      if (lazyDFA->match(controller, _isGreedy))
+        return FindResult{pos, controller.record()};
+      if (pos == str.size()) break;
     }
-    return false;
+    return std::nullopt;
   }
 
   struct Condition {
    public:
-    virtual bool operator()(DerivedController controller) const {
+    /**
+     * Test the input from the current position. The position is left
+     * anywhere, and the caller restores it.
+     */
+    virtual bool operator()(Controller& controller) const {
       return this->operator()(controller.get());
     };
 
-   protected:
+    /**
+     * @return {bool}  : Whether the condition only depends on the current
+     * char, so it can be evaluated byte by byte (e.g. to build a DFA)
+     */
+    [[nodiscard]] virtual bool isSingleChar() const { return true; }
+
+    // Test a single char, only valid if isSingleChar()
     virtual bool operator()(char) const { return false; };
   };
 
@@ -297,7 +1028,7 @@ class Regex {
   };
 
   struct AnyCondition : public Condition {
-   protected:
+   public:
     bool operator()(char) const override { return true; }
   };
 
@@ -307,10 +1038,13 @@ class Regex {
 
     explicit CharCondition(char value) : value(value){};
 
-   protected:
     bool operator()(char ch) const override { return value == ch; }
   };
 
+  /*
+   * (?=...) or (?!...) from the start state of its body. It reads no char,
+   * and FlatNFA tests it as a guard instead of calling it.
+   */
   struct LookaheadCondition : public Condition {
    public:
     const State* startState;
@@ -319,9 +1053,7 @@ class Regex {
     LookaheadCondition(State* startState, bool isInverted)
         : startState(startState), isInverted(isInverted){};
 
-    bool operator()(DerivedController controller) const override {
-      return !isInverted & Regex::match(*startState, controller);
-    }
+    [[nodiscard]] bool isSingleChar() const override { return false; }
   };
 
   struct CharRangeCondition : public Condition {
@@ -332,10 +1064,29 @@ class Regex {
     explicit CharRangeCondition(char start) : start(start){};
     CharRangeCondition(char start, char end) : start(start), end(end){};
 
-   protected:
     bool operator()(char ch) const override { return ch >= start && ch <= end; }
   };
 
+  // Any condition on a single char, as one bit for every byte
+  struct ByteSetCondition : public Condition {
+   public:
+    const ByteSet byteSet;
+
+    explicit ByteSetCondition(ByteSet byteSet) : byteSet(byteSet){};
+
+    // @param  condition : Must only depend on a single char
+    static ByteSet createByteSet(const Condition& condition) {
+      ByteSet byteSet;
+      for (size_t ch = 0; ch < byteSet.size(); ch++)
+        if (condition(static_cast<char>(ch))) byteSet.set(ch);
+      return byteSet;
+    }
+
+    bool operator()(char ch) const override {
+      return byteSet[static_cast<unsigned char>(ch)];
+    }
+  };
+
   struct CharSetCondition : public Condition {
    protected:
     std::list<std::shared_ptr<Condition>> conditionList;
@@ -346,18 +1097,59 @@ class Regex {
                      bool isInverted)
         : conditionList(std::move(conditionList)), isInverted(isInverted){};
 
-    bool operator()(DerivedController controller) const override {
-      size_t pos = controller.record();
+    bool operator()(char ch) const override {
       bool isInSet =
-          std::find_if(
-              conditionList.begin(), conditionList.end(),
-              [&controller, &pos](const std::shared_ptr<Condition>& condition) {
-                bool isMatched = condition->operator()(controller);
-                controller.restore(pos);
-                return isMatched;
-              }) != conditionList.end();
+          std::find_if(conditionList.begin(), conditionList.end(),
+                       [&ch](const std::shared_ptr<Condition>& condition) {
+                         return condition->operator()(ch);
+                       }) != conditionList.end();
+      return isInverted ^ isInSet;
+    }
+  };
+
+  /*
+   * Same as CharSetCondition, but a char of the set is a code point of
+   * UTF-8, which can have Unicode properties. The condition only matches a
+   * code point of the given length, and the transitions after it skip the
+   * rest of its bytes.
+   */
+  struct CodePointSetCondition : public CharSetCondition {
+   protected:
+    std::vector<Unicode::Property> propertyList;
+    const size_t length;
+    // Chars in the set before inverted
+    ByteSet asciiSet;
+
+   public:
+    CodePointSetCondition(std::list<std::shared_ptr<Condition>> conditionList,
+                          std::vector<Unicode::Property> propertyList,
+                          bool isInverted, size_t length)
+        : CharSetCondition(std::move(conditionList), isInverted),
+          propertyList(std::move(propertyList)),
+          length(length),
+          asciiSet(ByteSetCondition::createByteSet(
+              CharSetCondition(this->conditionList, false))){};
+
+    bool operator()(Controller& controller) const override {
+      size_t codePointLength = 0;
+      auto get = [&controller] {
+        return static_cast<unsigned char>(controller.get());
+      };
+      const char32_t codePoint = Unicode::decode(get, codePointLength);
+      if (codePoint == Unicode::INVALID || codePointLength != length)
+        return false;
+      // Other conditions only match ASCII
+      const bool isInSet =
+          (length == 1 && asciiSet[codePoint]) ||
+          std::ranges::any_of(propertyList, [&codePoint](auto property) {
+            return Unicode::hasProperty(codePoint, property);
+          });
       return isInverted ^ isInSet;
     }
+
+    [[nodiscard]] bool isSingleChar() const override { return false; }
+
+    [[nodiscard]] size_t getLength() const { return length; }
   };
 
   struct Token {
@@ -380,7 +1172,10 @@ class Regex {
       return false;
     }
 
-    enum EscapeType { NotEscape, EscapeChar, Newline, AnyDigit };
+    // Name of \p{Name} which is being read
+    std::optional<std::string> propertyName;
+
+    enum EscapeType { NotEscape, EscapeChar, Newline, AnyDigit, Property };
 
     EscapeType tryEscape(char ch) {
       EscapeType type = NotEscape;
@@ -393,6 +1188,10 @@ class Regex {
           case 'd':
             type = AnyDigit;
             break;
+          case 'p':
+            type = Property;
+            propertyName.emplace();
+            break;
           default:
             type = EscapeChar;
             break;
@@ -401,6 +1200,26 @@ class Regex {
       return type;
     }
 
+    /**
+     * Read a char of \p{Name} after \p.
+     *
+     * @return {std::optional<Unicode::Property>}  : The property once the
+     * name is closed
+     */
+    std::optional<Unicode::Property> readPropertyName(size_t pos, char ch) {
+      if (propertyName->empty() && ch != '{')
+        throw std::runtime_error("Expected a property name: " +
+                                 std::to_string(pos));
+      propertyName->push_back(ch);
+      if (ch != '}') return std::nullopt;
+      const auto property = Unicode::findProperty(
+          std::string_view(*propertyName).substr(1, propertyName->size() - 2));
+      if (!property)
+        throw std::runtime_error("Unknown property: " + std::to_string(pos));
+      propertyName.reset();
+      return property;
+    }
+
     template <class ConditionType>
       requires std::is_base_of<Condition, ConditionType>::value
     struct CustomConditionToken : ConditionAndToken {
@@ -418,8 +1237,17 @@ class Regex {
         return endState;
       }
 
-      bool operator()(DerivedController controller) const override {
-        return static_cast<Condition>(condition)(controller);
+      // Call through a reference, a copy would be sliced to Condition
+      bool operator()(Controller& controller) const override {
+        return static_cast<const Condition&>(condition)(controller);
+      }
+
+      bool operator()(char ch) const override {
+        return static_cast<const Condition&>(condition)(ch);
+      }
+
+      [[nodiscard]] bool isSingleChar() const override {
+        return condition.isSingleChar();
       }
     };
 
@@ -433,6 +1261,7 @@ class Regex {
         case AnyDigit:
           return std::make_unique<CustomConditionToken<CharRangeCondition>>(
               '0', '9');
+        case Property:
         case NotEscape:
           throw std::runtime_error("The char is not escaped: " +
                                    std::to_string(pos));
@@ -506,7 +1335,13 @@ class Regex {
     };
 
     bool push(ContainerStack& stack, size_t pos, char ch) override {
+      if (propertyName) {
+        if (auto property = readPropertyName(pos, ch))
+          tokenList.push_back(std::make_unique<CharSet>(*property));
+        return false;
+      }
       EscapeType type = tryEscape(ch);
+      if (type == Property) return false;
       if (type == NotEscape) {
         if (isEscapeSymbol(ch)) return false;
         switch (ch) {
@@ -575,17 +1410,41 @@ class Regex {
   struct CharSet : Container {
    protected:
     std::list<std::shared_ptr<Condition>> conditionList;
+    // From \p{Name}, which makes the set match code points
+    std::vector<Unicode::Property> propertyList;
 
     std::shared_ptr<CharRangeCondition> charRangeToBeFulfilled = nullptr;
 
    public:
     bool isInverted = false;
 
+    CharSet() = default;
+    explicit CharSet(Unicode::Property property) : propertyList{property} {}
+
     State& generate(Regex& regex, State& preState) const override {
       State& endState = regex.createState();
-      preState.addTransition(
-          {std::make_unique<CharSetCondition>(conditionList, isInverted),
-           &endState});
+      if (propertyList.empty()) {
+        // The inversion is folded into the bits
+        preState.addTransition(
+            {std::make_unique<ByteSetCondition>(
+                 ByteSetCondition::createByteSet(
+                     CharSetCondition(conditionList, isInverted))),
+             &endState});
+        return endState;
+      }
+      // One branch for every length of UTF-8 sequence
+      for (size_t length = 1; length <= 4; length++) {
+        State* state = length == 1 ? &endState : &regex.createState();
+        preState.addTransition({std::make_unique<CodePointSetCondition>(
+                                    conditionList, propertyList, isInverted,
+                                    length),
+                                state});
+        for (size_t i = 2; i <= length; i++) {
+          State* nextState = i == length ? &endState : &regex.createState();
+          state->addTransition({std::make_unique<AnyCondition>(), nextState});
+          state = nextState;
+        }
+      }
       return endState;
     };
 
@@ -599,7 +1458,13 @@ class Regex {
     }
 
     bool push(ContainerStack& stack, size_t pos, char ch) override {
+      if (propertyName) {
+        if (auto property = readPropertyName(pos, ch))
+          propertyList.push_back(*property);
+        return false;
+      }
       EscapeType type = tryEscape(ch);
+      if (type == EscapeType::Property) return false;
       if (type == EscapeType::NotEscape) {
         if (isEscapeSymbol(ch)) return false;
         switch (ch) {
@@ -621,7 +1486,7 @@ class Regex {
             stack.finishTopContainer(pos);
             break;
           case '^':
-            if (conditionList.empty()) {
+            if (size() == 0) {
               isInverted = true;
               break;
             }
@@ -631,7 +1496,8 @@ class Regex {
             break;
         }
       } else {
-        if (type != EscapeType::EscapeChar && !setCharRangeEnd(ch))
+        const char escapedChar = type == EscapeType::Newline ? '\n' : ch;
+        if (type == EscapeType::AnyDigit || !setCharRangeEnd(escapedChar))
           conditionList.push_back(createConditionFromEscapeType(pos, type, ch));
       }
       if (charRangeToBeFulfilled && ch != '-')
@@ -650,7 +1516,9 @@ class Regex {
       throw std::runtime_error("Expected a character: " + std::to_string(pos));
     };
 
-    [[nodiscard]] size_t size() const override { return conditionList.size(); };
+    [[nodiscard]] size_t size() const override {
+      return conditionList.size() + propertyList.size();
+    };
   };
 
   struct Alternation : Container {
@@ -671,7 +1539,13 @@ class Regex {
     };
 
     bool push(ContainerStack& stack, size_t pos, char ch) override {
+      if (propertyName) {
+        auto property = readPropertyName(pos, ch);
+        if (property) right = std::make_unique<CharSet>(*property);
+        return property.has_value();
+      }
       EscapeType type = tryEscape(ch);
+      if (type == EscapeType::Property) return false;
       if (type == EscapeType::NotEscape) {
         if (isEscapeSymbol(ch)) return false;
         switch (ch) {
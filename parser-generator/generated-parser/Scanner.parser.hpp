@@ -0,0 +1,177 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string_view>
+
+#include "Unicode.parser.hpp"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/*
+ * Find the next interesting byte in a buffer. A block of bytes is compared at
+ * once with AVX2 or SSE2 when the target supports it, and the tail is checked
+ * one byte at a time.
+ *
+ * Every function returns the offset of the byte found, or the size of the
+ * buffer if there is none.
+ */
+namespace GeneratedParser::Scanner {
+namespace Detail {
+#if defined(__AVX2__)
+struct Block {
+  using Vector = __m256i;
+  static constexpr inline size_t SIZE = 32;
+
+  static Vector load(const char* data) {
+    return _mm256_loadu_si256(reinterpret_cast<const Vector*>(data));
+  }
+  static Vector splat(char ch) { return _mm256_set1_epi8(ch); }
+  static Vector equal(Vector a, Vector b) { return _mm256_cmpeq_epi8(a, b); }
+  static Vector either(Vector a, Vector b) { return _mm256_or_si256(a, b); }
+  // Unsigned a <= b
+  static Vector lessEqual(Vector a, Vector b) {
+    return _mm256_cmpeq_epi8(_mm256_min_epu8(a, b), a);
+  }
+  static Vector subtract(Vector a, Vector b) { return _mm256_sub_epi8(a, b); }
+  static uint32_t mask(Vector vector) {
+    return static_cast<uint32_t>(_mm256_movemask_epi8(vector));
+  }
+};
+#elif defined(__SSE2__)
+struct Block {
+  using Vector = __m128i;
+  static constexpr inline size_t SIZE = 16;
+
+  static Vector load(const char* data) {
+    return _mm_loadu_si128(reinterpret_cast<const Vector*>(data));
+  }
+  static Vector splat(char ch) { return _mm_set1_epi8(ch); }
+  static Vector equal(Vector a, Vector b) { return _mm_cmpeq_epi8(a, b); }
+  static Vector either(Vector a, Vector b) { return _mm_or_si128(a, b); }
+  // Unsigned a <= b
+  static Vector lessEqual(Vector a, Vector b) {
+    return _mm_cmpeq_epi8(_mm_min_epu8(a, b), a);
+  }
+  static Vector subtract(Vector a, Vector b) { return _mm_sub_epi8(a, b); }
+  static uint32_t mask(Vector vector) {
+    return static_cast<uint32_t>(_mm_movemask_epi8(vector));
+  }
+};
+#endif
+
+/**
+ * @param  blockMatch  : Mask of the bytes matched in a block
+ * @param  byteMatch   : Whether a single byte is matched
+ */
+template <class BlockMatch, class ByteMatch>
+size_t find(std::string_view buffer, BlockMatch blockMatch,
+            ByteMatch byteMatch) {
+  size_t i = 0;
+#if defined(__AVX2__) || defined(__SSE2__)
+  for (; i + Block::SIZE <= buffer.size(); i += Block::SIZE) {
+    uint32_t mask = blockMatch(Block::load(buffer.data() + i));
+    if (mask != 0) return i + __builtin_ctz(mask);
+  }
+#endif
+  for (; i < buffer.size(); i++)
+    if (byteMatch(static_cast<unsigned char>(buffer[i]))) return i;
+  return buffer.size();
+}
+
+// Same as std::isspace in the "C" locale
+constexpr bool isSpace(unsigned char ch) {
+  return ch == ' ' || (ch >= '\t' && ch <= '\r');
+}
+}  // namespace Detail
+
+inline size_t findNotSpace(std::string_view buffer) {
+#if defined(__AVX2__) || defined(__SSE2__)
+  using Detail::Block;
+  const auto space = Block::splat(' ');
+  const auto tab = Block::splat('\t');
+  const auto range = Block::splat('\r' - '\t');
+  return Detail::find(
+      buffer,
+      [&](Block::Vector vector) {
+        auto isSpace = Block::either(
+            Block::equal(vector, space),
+            Block::lessEqual(Block::subtract(vector, tab), range));
+        return static_cast<uint32_t>(~Block::mask(isSpace) &
+                                     ((uint64_t{1} << Block::SIZE) - 1));
+      },
+      [](unsigned char ch) { return !Detail::isSpace(ch); });
+#else
+  return Detail::find(buffer, nullptr,
+                      [](unsigned char ch) { return !Detail::isSpace(ch); });
+#endif
+}
+
+inline size_t findByte(std::string_view buffer, char target) {
+  const void* found = std::memchr(buffer.data(), target, buffer.size());
+  return found == nullptr ? buffer.size()
+                          : static_cast<const char*>(found) - buffer.data();
+}
+
+inline size_t findEitherByte(std::string_view buffer, char first,
+                             char second) {
+#if defined(__AVX2__) || defined(__SSE2__)
+  using Detail::Block;
+  const auto firstVector = Block::splat(first);
+  const auto secondVector = Block::splat(second);
+  return Detail::find(
+      buffer,
+      [&](Block::Vector vector) {
+        return Block::mask(Block::either(Block::equal(vector, firstVector),
+                                         Block::equal(vector, secondVector)));
+      },
+      [&](unsigned char ch) {
+        return ch == static_cast<unsigned char>(first) ||
+               ch == static_cast<unsigned char>(second);
+      });
+#else
+  return Detail::find(buffer, nullptr, [&](unsigned char ch) {
+    return ch == static_cast<unsigned char>(first) ||
+           ch == static_cast<unsigned char>(second);
+  });
+#endif
+}
+
+inline size_t findNotAscii(std::string_view buffer) {
+#if defined(__AVX2__) || defined(__SSE2__)
+  using Detail::Block;
+  // The high bit of every byte
+  return Detail::find(
+      buffer, [](Block::Vector vector) { return Block::mask(vector); },
+      [](unsigned char ch) { return ch >= 0x80; });
+#else
+  return Detail::find(buffer, nullptr,
+                      [](unsigned char ch) { return ch >= 0x80; });
+#endif
+}
+
+/**
+ * Find the first byte which does not start a valid UTF-8 sequence, including
+ * a sequence cut by the end of the buffer. ASCII is skipped a block at a time,
+ * and only the other sequences are decoded.
+ */
+inline size_t findInvalidUtf8(std::string_view buffer) {
+  size_t i = 0;
+  while ((i += findNotAscii(buffer.substr(i))) < buffer.size()) {
+    size_t next = i;
+    size_t length = 0;
+    auto get = [&buffer, &next]() -> int {
+      if (next >= buffer.size()) return EOF;
+      return static_cast<unsigned char>(buffer[next++]);
+    };
+    if (Unicode::decode(get, length) == Unicode::INVALID) return i;
+    i += length;
+  }
+  return buffer.size();
+}
+}  // namespace GeneratedParser::Scanner
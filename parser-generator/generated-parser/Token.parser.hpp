@@ -0,0 +1,144 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace GeneratedParser {
+using TokenType = int;
+static inline const TokenType Eof = -1;
+
+// A range in the source
+struct Span {
+  size_t offset = 0;
+  size_t length = 0;
+};
+
+struct Token {
+  TokenType type = -1;
+  Span span;
+};
+
+// removedLength bytes at offset are replaced by insertedLength bytes
+struct TextEdit {
+  size_t offset = 0;
+  size_t removedLength = 0;
+  size_t insertedLength = 0;
+};
+
+// Tokens [first, first + removedCount) are replaced by
+// [first, first + insertedCount)
+struct TokenChange {
+  size_t first = 0;
+  size_t removedCount = 0;
+  size_t insertedCount = 0;
+};
+
+/*
+ * Tokens as a structure of arrays, so going through the types does not touch
+ * the offsets. An offset or a length takes 32 bits, which limits a source to
+ * 4 GiB.
+ *
+ * The lookahead of a token is the number of bytes after it which the lexer
+ * looked at to decide it. An edit only changes the tokens which looked at it.
+ */
+class TokenBuffer {
+ public:
+  static constexpr inline size_t MAX_SOURCE_SIZE =
+      std::numeric_limits<uint32_t>::max();
+
+ protected:
+  std::vector<TokenType> typeList;
+  std::vector<uint32_t> offsetList;
+  std::vector<uint32_t> lengthList;
+  std::vector<uint32_t> lookaheadList;
+  // Upper bound of length + lookahead of every token
+  size_t maxExtent = 0;
+
+ public:
+  [[nodiscard]] size_t size() const { return typeList.size(); }
+  [[nodiscard]] bool empty() const { return typeList.empty(); }
+
+  void push(TokenType type, const Span& span, size_t lookahead = 0) {
+    typeList.push_back(type);
+    offsetList.push_back(static_cast<uint32_t>(span.offset));
+    lengthList.push_back(static_cast<uint32_t>(span.length));
+    lookaheadList.push_back(static_cast<uint32_t>(lookahead));
+    maxExtent = std::max(maxExtent, span.length + lookahead);
+  }
+
+  // Append the tokens of another buffer from index first
+  void append(const TokenBuffer& another, size_t first) {
+    replace(size(), 0, another, first, another.size(), 0);
+  }
+
+  /**
+   * Replace count tokens from index first by the tokens [from, to) of
+   * another buffer. The offsets of the tokens after them are moved by delta.
+   */
+  void replace(size_t first, size_t count, const TokenBuffer& another,
+               size_t from, size_t to, std::ptrdiff_t delta) {
+    auto splice = [&](auto& list, const auto& anotherList) {
+      list.erase(list.begin() + first, list.begin() + first + count);
+      list.insert(list.begin() + first, anotherList.begin() + from,
+                  anotherList.begin() + to);
+    };
+    splice(typeList, another.typeList);
+    splice(offsetList, another.offsetList);
+    splice(lengthList, another.lengthList);
+    splice(lookaheadList, another.lookaheadList);
+    if (delta != 0)
+      for (size_t i = first + (to - from); i < offsetList.size(); i++)
+        offsetList[i] = static_cast<uint32_t>(offsetList[i] + delta);
+    maxExtent = std::max(maxExtent, another.maxExtent);
+  }
+
+  [[nodiscard]] TokenType getType(size_t index) const {
+    return typeList[index];
+  }
+
+  [[nodiscard]] Span getSpan(size_t index) const {
+    return {offsetList[index], lengthList[index]};
+  }
+
+  [[nodiscard]] size_t getLookahead(size_t index) const {
+    return lookaheadList[index];
+  }
+
+  [[nodiscard]] Token operator[](size_t index) const {
+    return {getType(index), getSpan(index)};
+  }
+
+  /**
+   * @return {size_t}  : Index of the token starting at offset, or size() if
+   * there is none
+   */
+  [[nodiscard]] size_t find(size_t offset) const {
+    auto it = std::ranges::lower_bound(offsetList, offset);
+    if (it == offsetList.end() || *it != offset) return size();
+    return it - offsetList.begin();
+  }
+
+  /**
+   * @return {size_t}  : Index of the first token which looked at the byte at
+   * offset or after it, or size() if there is none
+   */
+  [[nodiscard]] size_t findLookingAt(size_t offset) const {
+    auto it = std::ranges::lower_bound(
+        offsetList, offset > maxExtent ? offset - maxExtent : 0);
+    for (size_t i = it - offsetList.begin(); i < size(); i++)
+      if (size_t{offsetList[i]} + lengthList[i] + lookaheadList[i] > offset)
+        return i;
+    return size();
+  }
+
+  // Same tokens, the lookahead is not compared
+  bool operator==(const TokenBuffer& another) const {
+    return typeList == another.typeList &&
+           offsetList == another.offsetList &&
+           lengthList == another.lengthList;
+  }
+};
+}  // namespace GeneratedParser
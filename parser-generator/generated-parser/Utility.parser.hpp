@@ -1,26 +1,152 @@
 #pragma once
 
+#include <algorithm>
+#include <cstdint>
 #include <istream>
-#include <iterator>
 #include <stdexcept>
+#include <string>
+#include <string_view>
 #include <vector>
 
+#include "Position.parser.hpp"
+#include "Scanner.parser.hpp"
+
 namespace GeneratedParser::Utility {
-class ForwardBufferedInputStream {
+// Compile-time string hash
+static constexpr unsigned long hashStartNumber = 5381;
+static constexpr unsigned long hashStepNumber = 5U;
+constexpr unsigned long hash(std::string_view str) {
+  unsigned long hash = hashStartNumber;
+  for (const auto& ch : str) {
+    hash = ((hash << hashStepNumber) + hash) + ch; /* hash * 33 + c */
+  }
+  return hash;
+}
+
+/*
+ * Set of integers below a fixed capacity, as described by Briggs and Torczon.
+ * Insert, lookup and clear take constant time, and the set is iterated in
+ * insertion order without visiting empty slots.
+ */
+class SparseSet {
+ protected:
+  std::vector<uint32_t> denseList;
+  // Index of a value in denseList, only valid if it points back to the value
+  std::vector<uint32_t> sparseList;
+  size_t count = 0;
+
+ public:
+  explicit SparseSet(size_t capacity)
+      : denseList(capacity), sparseList(capacity){};
+
+  [[nodiscard]] bool contains(uint32_t value) const {
+    const uint32_t index = sparseList[value];
+    return index < count && denseList[index] == value;
+  }
+
+  // @return {bool}  : False if the value is already in the set
+  bool insert(uint32_t value) {
+    if (contains(value)) return false;
+    sparseList[value] = count;
+    denseList[count++] = value;
+    return true;
+  }
+
+  void clear() { count = 0; }
+
+  [[nodiscard]] bool empty() const { return count == 0; }
+
+  [[nodiscard]] size_t size() const { return count; }
+
+  [[nodiscard]] auto begin() const { return denseList.begin(); }
+
+  [[nodiscard]] auto end() const { return denseList.begin() + count; }
+};
+
+/*
+ * Forward input stream over a growing buffer. A std::istream is read in large
+ * blocks which are appended to the buffer, and nothing is dropped, so tokens
+ * can refer to the source by span. A contiguous source is used in place and
+ * never copied at all.
+ *
+ * Positions returned by tellg() are offsets in the input.
+ */
+class ChunkedInputStream {
+ public:
+  static constexpr inline size_t BLOCK_SIZE = 64 * 1024;
+
  protected:
-  std::istream& stream;
-  std::vector<int> buffer;
+  std::istream* stream = nullptr;
+  std::vector<char> storage;
+
+  const char* data = nullptr;
+  size_t size = 0;
   size_t index = 0;
+  // The furthest position before going back with seekg()
+  size_t furthest = 0;
+  // Bytes before it are valid UTF-8, if the input is checked
+  bool isUtf8Checked = false;
+  size_t checkedEnd = 0;
+
+  /**
+   * Check the bytes read since the last check. A sequence cut by the end of
+   * the buffer is checked again with the next block, unless it is the end.
+   */
+  void checkUtf8(bool isEnd) {
+    const std::string_view unchecked(data + checkedEnd, size - checkedEnd);
+    const size_t pos = Scanner::findInvalidUtf8(unchecked);
+    if (pos < unchecked.size()) {
+      const auto lead = static_cast<unsigned char>(unchecked[pos]);
+      const bool isCut =
+          unchecked.size() - pos < Unicode::getSequenceLength(lead);
+      if (isEnd || !isCut)
+        throw createSyntaxError("Invalid UTF-8", checkedEnd + pos);
+    }
+    checkedEnd += pos;
+  }
+
+  /**
+   * Make sure data[index] is available.
+   *
+   * @return {bool}  : False if the input is exhausted
+   */
+  bool fill() {
+    if (stream == nullptr) return false;
+    while (index >= size) {
+      if (storage.size() < size + BLOCK_SIZE)
+        storage.resize(size + BLOCK_SIZE);
+      data = storage.data();
+      stream->read(storage.data() + size, BLOCK_SIZE);
+      auto count = static_cast<size_t>(stream->gcount());
+      if (count == 0) {
+        if (isUtf8Checked) checkUtf8(true);
+        return false;
+      }
+      size += count;
+      if (isUtf8Checked) checkUtf8(false);
+    }
+    return true;
+  }
 
  public:
-  explicit ForwardBufferedInputStream(std::istream& stream) : stream(stream){};
+  explicit ChunkedInputStream(std::istream& stream) : stream(&stream){};
+  explicit ChunkedInputStream(std::string_view source)
+      : data(source.data()), size(source.size()){};
+
+  /**
+   * Throw SyntaxError at the first byte which is not valid UTF-8. A
+   * contiguous source is checked at once, and a std::istream is checked a
+   * block at a time as it is read.
+   */
+  void checkUtf8() {
+    isUtf8Checked = true;
+    checkedEnd = 0;
+    checkUtf8(stream == nullptr);
+  }
 
   int peek() {
-    while (index + 1 > buffer.size()) {
-      if (!buffer.empty() && buffer.back() == EOF) return EOF;
-      buffer.push_back(stream.get());
-    }
-    return buffer.at(index);
+    if (index < size || fill()) return static_cast<unsigned char>(data[index]);
+    return EOF;
   }
 
   void read() { index++; }
@@ -31,21 +157,86 @@ class ForwardBufferedInputStream {
     return currentChar;
   }
 
-  [[nodiscard]] size_t tellg() const { return index; }
+  /**
+   * @return {std::string_view}  : Bytes from the current position which are
+   * already buffered. Empty if the input is exhausted.
+   */
+  std::string_view peekWindow() {
+    if (index >= size && !fill()) return {};
+    return {data + index, size - index};
+  }
+
+  /**
+   * Buffer the rest of the input. The position is not changed.
+   *
+   * @return {std::string_view}  : The whole input
+   */
+  std::string_view readAll() {
+    const size_t position = tellg();
+    do {
+      index = size;
+    } while (fill());
+    seekg(position);
+    return {data, size};
+  }
 
-  void seekg(size_t index) { this->index = index; }
+  void skip(size_t count) { index += count; }
 
-  void shrinkBufferToIndex() {
-    if (index > 0) {
-      buffer = {std::next(buffer.begin(), static_cast<int>(index)),
-                buffer.end()};
-      index = 0;
+  /**
+   * Skip until find() returns a position inside the window, so a scanner can
+   * look at many bytes at once.
+   *
+   * @param  find : Called with peekWindow(), returns the offset of the byte
+   * to stop at or the size of the window
+   */
+  template <class Find>
+  void skipUntil(Find find) {
+    std::string_view window;
+    while (!(window = peekWindow()).empty()) {
+      size_t pos = find(window);
+      skip(pos);
+      if (pos < window.size()) return;
     }
   }
 
-  std::string getBufferToIndexAsString() {
-    auto begin = buffer.begin();
-    return {begin, std::next(begin, static_cast<int>(index))};
+  [[nodiscard]] size_t tellg() const { return index; }
+
+  // Position after the last buffered byte
+  [[nodiscard]] size_t getBufferedEnd() const { return size; }
+
+  void seekg(size_t index) {
+    furthest = std::max(furthest, tellg());
+    this->index = index;
+  }
+
+  /**
+   * @return {size_t}  : The furthest position reached since the last
+   * resetFurthest(). The byte there could have been peeked.
+   */
+  [[nodiscard]] size_t getFurthest() const {
+    return std::max(furthest, tellg());
+  }
+
+  void resetFurthest() { furthest = tellg(); }
+
+  /**
+   * Same error as the lexer, for code which has no lexer at hand. The line
+   * starts are found again every time, since the input before offset is
+   * still buffered.
+   */
+  [[nodiscard]] SyntaxError createSyntaxError(const std::string& message,
+                                              size_t offset) const {
+    LineIndex lineIndex;
+    lineIndex.extend({data, offset});
+    return {message, offset, lineIndex.getPosition(offset)};
+  }
+
+  /**
+   * @param  pos    : Position which must already be buffered
+   * @return {std::string_view}  : Valid until more input is read
+   */
+  [[nodiscard]] std::string_view substr(size_t pos, size_t length) const {
+    return {data + pos, length};
   }
 };
 }  // namespace GeneratedParser::Utility
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <string_view>
+
+#include "ByteSet.parser.hpp"
+#include "Regex.parser.hpp"
+
+namespace ParserGenerator {
+using ByteSet = GeneratedParser::ByteSet;
+
+/**
+ * @return {ByteSet}  : Bytes the condition holds for. EOF is excluded
+ * because a regex stops there.
+ */
+ByteSet createConditionByteSet(
+    const GeneratedParser::Regex::Condition& condition);
+
+/**
+ * Bytes a terminal can start with. A terminal which matches the empty string
+ * can start with any byte.
+ */
+ByteSet createFirstByteSet(std::string_view str);
+
+ByteSet createFirstByteSet(const GeneratedParser::Regex& regex);
+}  // namespace ParserGenerator
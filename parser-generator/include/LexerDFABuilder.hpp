@@ -0,0 +1,98 @@
+#pragma once
+
+#include <list>
+#include <map>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "ByteSet.parser.hpp"
+#include "LexerDFA.parser.hpp"
+#include "Regex.parser.hpp"
+
+namespace ParserGenerator {
+/*
+ * Build one minimized DFA over all terminals. Terminals which can not be
+ * matched byte by byte (e.g. regex with lookahead or non-greedy regex) are
+ * skipped and left to the runtime matchers.
+ */
+class LexerDFABuilder {
+ protected:
+  using ByteSet = GeneratedParser::ByteSet;
+  using StateSet = std::vector<size_t>;
+
+  static constexpr inline size_t NOT_ACCEPTED = -1;
+
+  struct NFAState {
+    std::vector<size_t> epsilonList;
+    std::vector<std::pair<ByteSet, size_t>> edgeList;
+    size_t acceptedTerminal = NOT_ACCEPTED;
+  };
+
+  std::vector<NFAState> stateList;
+  std::vector<size_t> startStateList;
+  std::map<size_t, std::vector<size_t>> excludeMap;
+  std::vector<bool> coveredList;
+  // String terminals are only turned into states when the DFA is built,
+  // because the ones the word excludes are left out
+  std::map<size_t, std::string> stringMap;
+  // Start state of every regex, indexed by terminal
+  std::unordered_map<size_t, size_t> regexStartMap;
+  // Whether a word can be picked, see addRegexExclude()
+  const bool isWordEnabled;
+
+  size_t createState() {
+    stateList.emplace_back();
+    return stateList.size() - 1;
+  }
+
+  void setCovered(size_t terminal);
+
+  [[nodiscard]] static bool isCompilable(const GeneratedParser::Regex& regex);
+
+  void addRegexStates(size_t terminal, const GeneratedParser::Regex& regex);
+
+  [[nodiscard]] StateSet closure(StateSet stateSet) const;
+
+  [[nodiscard]] std::vector<uint8_t> createByteClassMap(
+      size_t& byteClassCount) const;
+
+  void addStringStates(size_t terminal, std::string_view str);
+
+  // Whether the regex starting from startState accepts the whole string
+  [[nodiscard]] bool isAccepted(size_t startState, std::string_view str) const;
+
+ public:
+  /**
+   * @param  isWordEnabled : False to exclude every terminal in the DFA
+   * itself, e.g. for a DFA which only decides one terminal
+   */
+  explicit LexerDFABuilder(bool isWordEnabled = true)
+      : isWordEnabled(isWordEnabled) {}
+
+  void addString(size_t terminal, std::string_view str);
+
+  /**
+   * @return {bool}  : Whether the regex can be compiled into the DFA
+   */
+  bool addRegex(size_t terminal, std::string_view regexStr);
+
+  /**
+   * Accept what the regex accepts, unless one of the excluded terminals
+   * accepts the same input.
+   *
+   * The first such terminal which only excludes strings becomes the word of
+   * the DFA (e.g. identifier and keywords). It is accepted without any
+   * exclusion, and the excluded strings it accepts are not compiled at all.
+   * The runtime looks up the maximal word in the string hash instead.
+   *
+   * @return {bool}  : Whether the regex can be compiled into the DFA
+   */
+  bool addRegexExclude(size_t terminal, std::string_view regexStr,
+                       const std::list<size_t>& excludeList);
+
+  // Can only be called once
+  [[nodiscard]] GeneratedParser::LexerDFA build();
+};
+}  // namespace ParserGenerator
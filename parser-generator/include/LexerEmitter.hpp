@@ -0,0 +1,39 @@
+#pragma once
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "LexerDFA.parser.hpp"
+
+namespace ParserGenerator {
+/*
+ * Write the DFAs of lexer matchers as C++ in the style of re2c: every state
+ * is a label with a switch over the next byte, and a transition is a goto. So
+ * the compiler sees the whole scanner instead of a transition table. Each DFA
+ * becomes a LexerDFA::ScanFunction, listed by getEmittedScanList().
+ */
+class LexerEmitter {
+ protected:
+  struct Entry {
+    size_t terminal;
+    // The constant of the terminal in the header, or empty if it has none
+    std::string name;
+    GeneratedParser::LexerDFA dfa;
+  };
+
+  std::vector<Entry> entryList;
+
+  static void emitScanFunction(std::ostream& os, const std::string& function,
+                               const GeneratedParser::LexerDFA& dfa);
+
+ public:
+  // The DFA must accept the terminal as terminal 0, like a DFA matcher
+  void add(size_t terminal, std::string name, GeneratedParser::LexerDFA dfa) {
+    entryList.push_back({terminal, std::move(name), std::move(dfa)});
+  }
+
+  // @param  header : The header with the terminal constants
+  void emit(std::ostream& os, const std::string& header) const;
+};
+}  // namespace ParserGenerator
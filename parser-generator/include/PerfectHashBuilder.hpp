@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "PerfectHash.parser.hpp"
+
+namespace ParserGenerator {
+/*
+ * Search a multiplier so that every key gets its own slot. The table starts
+ * with the smallest power of two which can hold all keys, and grows if no
+ * multiplier is found.
+ */
+class PerfectHashBuilder {
+ protected:
+  static constexpr inline size_t ATTEMPT_COUNT = 1 << 16;
+  static constexpr inline size_t MAX_GROWTH = 4;
+
+  // Keys must outlive the built hash
+  std::vector<std::pair<std::string_view, uint32_t>> entryList;
+
+  [[nodiscard]] bool tryBuild(GeneratedParser::PerfectHash& perfectHash) const;
+
+ public:
+  void add(std::string_view key, uint32_t value) {
+    entryList.emplace_back(key, value);
+  }
+
+  [[nodiscard]] GeneratedParser::PerfectHash build() const noexcept(false);
+};
+}  // namespace ParserGenerator
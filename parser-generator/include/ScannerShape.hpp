@@ -0,0 +1,34 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+
+namespace ParserGenerator {
+/*
+ * Regex terminals of a few common shapes are matched by a scanner at runtime
+ * instead of the regex, which jumps over many bytes at once.
+ */
+struct ScannerShape {
+  enum Type {
+    None = -1,
+    // /[^c]*/
+    UntilByte = 3,
+    // /([^a]|(a(?!b)))*/
+    UntilSequence = 4,
+    // /q([^q\\]|(\\.))*q/
+    Quoted = 5,
+    // /[s\p{ID_Start}][p\p{ID_Continue}]*/, where s and p are ASCII chars
+    Identifier = 6
+  } type = None;
+  char first = 0;
+  char second = 0;
+  // Chars an identifier can also start with or contain
+  std::string extraStart;
+  std::string extraPart;
+
+  static ScannerShape detect(std::string_view regexStr);
+
+  // Regex of the ASCII identifiers of an Identifier shape
+  [[nodiscard]] std::string createAsciiRegex() const;
+};
+}  // namespace ParserGenerator
@@ -0,0 +1,61 @@
+#include "FirstByteSet.hpp"
+
+#include <stack>
+#include <unordered_set>
+
+using namespace ParserGenerator;
+using Regex = GeneratedParser::Regex;
+
+ByteSet ParserGenerator::createConditionByteSet(
+    const Regex::Condition& condition) {
+  ByteSet byteSet;
+  for (int ch = 0; ch < 256; ch++) {
+    if (static_cast<char>(ch) == EOF) continue;
+    const char byte = static_cast<char>(ch);
+    Regex::StringController controller({&byte, 1});
+    if (condition(controller)) byteSet.set(ch);
+  }
+  return byteSet;
+}
+
+ByteSet ParserGenerator::createFirstByteSet(std::string_view str) {
+  ByteSet byteSet;
+  if (str.empty())
+    byteSet.set();
+  else
+    byteSet.set(static_cast<unsigned char>(str.front()));
+  return byteSet;
+}
+
+ByteSet ParserGenerator::createFirstByteSet(const Regex& regex) {
+  ByteSet byteSet;
+  std::unordered_set<const Regex::State*> visited{&regex.getStartState()};
+  std::stack<const Regex::State*> stack({&regex.getStartState()});
+  while (!stack.empty()) {
+    const Regex::State* state = stack.top();
+    stack.pop();
+    const auto& transitionList = state->getTransitionList();
+    // The regex matches the empty string
+    if (transitionList.empty()) return ByteSet().set();
+    for (const auto& transition : transitionList) {
+      if (!transition.condition) {
+        if (visited.insert(transition.state).second)
+          stack.push(transition.state);
+      } else if (const auto* codePointSet =
+                     dynamic_cast<const Regex::CodePointSetCondition*>(
+                         transition.condition.get())) {
+        // Any lead of a longer code point, which is not told by one byte
+        byteSet |= createConditionByteSet(*codePointSet);
+        for (int ch = 0x80; ch < 256; ch++)
+          if (GeneratedParser::Unicode::getSequenceLength(ch) ==
+              codePointSet->getLength())
+            byteSet.set(ch);
+      } else if (!transition.condition->isSingleChar())
+        // Can not tell by one byte
+        return ByteSet().set();
+      else
+        byteSet |= createConditionByteSet(*transition.condition);
+    }
+  }
+  return byteSet;
+}
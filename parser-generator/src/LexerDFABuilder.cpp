@@ -0,0 +1,348 @@
+#include "LexerDFABuilder.hpp"
+
+#include <algorithm>
+#include <map>
+#include <queue>
+#include <stack>
+#include <unordered_map>
+
+#include "FirstByteSet.hpp"
+
+using namespace ParserGenerator;
+using LexerDFA = GeneratedParser::LexerDFA;
+using Regex = GeneratedParser::Regex;
+
+void LexerDFABuilder::setCovered(size_t terminal) {
+  if (coveredList.size() <= terminal) coveredList.resize(terminal + 1);
+  coveredList[terminal] = true;
+}
+
+bool LexerDFABuilder::isCompilable(const Regex& regex) {
+  if (!regex.isGreedy()) return false;
+  return std::ranges::all_of(regex.stateList, [](const Regex::State& state) {
+    return std::ranges::all_of(
+        state.getTransitionList(), [](const Regex::Transition& transition) {
+          return !transition.condition || transition.condition->isSingleChar();
+        });
+  });
+}
+
+void LexerDFABuilder::addRegexStates(size_t terminal, const Regex& regex) {
+  std::unordered_map<const Regex::State*, size_t> stateIndexMap;
+  for (const auto& state : regex.stateList)
+    stateIndexMap.emplace(&state, createState());
+  for (const auto& state : regex.stateList) {
+    NFAState& nfaState = stateList[stateIndexMap.at(&state)];
+    const auto& transitionList = state.getTransitionList();
+    // Same as Regex::State::isMatched, a state without any transition is the
+    // end of the regex
+    if (transitionList.empty()) nfaState.acceptedTerminal = terminal;
+    for (const auto& transition : transitionList) {
+      size_t to = stateIndexMap.at(transition.state);
+      if (!transition.condition) {
+        nfaState.epsilonList.push_back(to);
+        continue;
+      }
+      const ByteSet byteSet = createConditionByteSet(*transition.condition);
+      if (byteSet.any()) nfaState.edgeList.emplace_back(byteSet, to);
+    }
+  }
+  startStateList.push_back(stateIndexMap.at(&regex.getStartState()));
+  regexStartMap.emplace(terminal, startStateList.back());
+  setCovered(terminal);
+}
+
+void LexerDFABuilder::addStringStates(size_t terminal, std::string_view str) {
+  size_t current = createState();
+  startStateList.push_back(current);
+  for (const char& ch : str) {
+    size_t next = createState();
+    ByteSet byteSet;
+    byteSet.set(static_cast<unsigned char>(ch));
+    stateList[current].edgeList.emplace_back(byteSet, next);
+    current = next;
+  }
+  stateList[current].acceptedTerminal = terminal;
+}
+
+void LexerDFABuilder::addString(size_t terminal, std::string_view str) {
+  stringMap.emplace(terminal, str);
+  setCovered(terminal);
+}
+
+bool LexerDFABuilder::isAccepted(size_t startState,
+                                 std::string_view str) const {
+  StateSet stateSet = closure({startState});
+  for (const char& ch : str) {
+    StateSet nextSet;
+    for (size_t state : stateSet)
+      for (const auto& [byteSet, to] : stateList[state].edgeList)
+        if (byteSet.test(static_cast<unsigned char>(ch))) nextSet.push_back(to);
+    std::ranges::sort(nextSet);
+    nextSet.erase(std::unique(nextSet.begin(), nextSet.end()), nextSet.end());
+    stateSet = closure(std::move(nextSet));
+  }
+  return std::ranges::any_of(stateSet, [this](size_t state) {
+    return stateList[state].acceptedTerminal != NOT_ACCEPTED;
+  });
+}
+
+bool LexerDFABuilder::addRegex(size_t terminal, std::string_view regexStr) {
+  const Regex regex(regexStr);
+  if (!isCompilable(regex)) return false;
+  addRegexStates(terminal, regex);
+  return true;
+}
+
+bool LexerDFABuilder::addRegexExclude(size_t terminal,
+                                      std::string_view regexStr,
+                                      const std::list<size_t>& excludeList) {
+  const Regex regex(regexStr);
+  if (!isCompilable(regex)) return false;
+  addRegexStates(terminal, regex);
+  excludeMap.emplace(
+      terminal, std::vector<size_t>{excludeList.begin(), excludeList.end()});
+  return true;
+}
+
+LexerDFABuilder::StateSet LexerDFABuilder::closure(StateSet stateSet) const {
+  std::vector<bool> visited(stateList.size());
+  std::stack<size_t> stack;
+  for (size_t state : stateSet) {
+    visited[state] = true;
+    stack.push(state);
+  }
+  while (!stack.empty()) {
+    size_t state = stack.top();
+    stack.pop();
+    for (size_t to : stateList[state].epsilonList) {
+      if (visited[to]) continue;
+      visited[to] = true;
+      stateSet.push_back(to);
+      stack.push(to);
+    }
+  }
+  std::ranges::sort(stateSet);
+  return stateSet;
+}
+
+std::vector<uint8_t> LexerDFABuilder::createByteClassMap(
+    size_t& byteClassCount) const {
+  // Two bytes are in the same class if no edge can tell them apart
+  std::vector<std::vector<bool>> signatureList(256);
+  for (const auto& state : stateList)
+    for (const auto& [byteSet, _] : state.edgeList)
+      for (size_t ch = 0; ch < 256; ch++)
+        signatureList[ch].push_back(byteSet.test(ch));
+  std::map<std::vector<bool>, uint8_t> classMap;
+  std::vector<uint8_t> byteClassMap(256);
+  for (size_t ch = 0; ch < 256; ch++) {
+    auto [it, _] = classMap.try_emplace(std::move(signatureList[ch]),
+                                        classMap.size());
+    byteClassMap[ch] = it->second;
+  }
+  byteClassCount = classMap.size();
+  return byteClassMap;
+}
+
+LexerDFA LexerDFABuilder::build() {
+  // Find the word
+  auto effectiveExcludeMap = excludeMap;
+  uint32_t wordTerminal = LexerDFA::NO_WORD;
+  std::vector<uint32_t> wordExcludeList;
+  // Only strings are excluded
+  auto isWord = [this](const auto& entry) {
+    return std::ranges::all_of(entry.second, [this](size_t excluded) {
+      return stringMap.contains(excluded);
+    });
+  };
+  auto wordIt = isWordEnabled
+                    ? std::ranges::find_if(effectiveExcludeMap, isWord)
+                    : effectiveExcludeMap.end();
+  if (wordIt != effectiveExcludeMap.end()) {
+    wordTerminal = wordIt->first;
+    wordExcludeList = {wordIt->second.begin(), wordIt->second.end()};
+    std::ranges::sort(wordExcludeList);
+    effectiveExcludeMap.erase(wordIt);
+  }
+  // Only a string the word excludes is told apart by the lookup. Another
+  // string the word accepts, e.g. "[" for /[$_A-z]+/, can be followed by more
+  // of the word, so the maximal word is not the string and it needs states.
+  for (const auto& [terminal, str] : stringMap) {
+    if (wordTerminal != LexerDFA::NO_WORD &&
+        std::ranges::binary_search(wordExcludeList, terminal) &&
+        isAccepted(regexStartMap.at(wordTerminal), str))
+      continue;
+    addStringStates(terminal, str);
+  }
+
+  // An exclude terminal can only be compiled when all excluded terminals are
+  // in the DFA as well
+  std::vector<bool> effectiveCoveredList = coveredList;
+  for (const auto& [terminal, excludeList] : effectiveExcludeMap)
+    if (!std::ranges::all_of(excludeList, [&](size_t excluded) {
+          return excluded < coveredList.size() && coveredList[excluded];
+        }))
+      effectiveCoveredList[terminal] = false;
+
+  size_t byteClassCount = 0;
+  const std::vector<uint8_t> byteClassMap = createByteClassMap(byteClassCount);
+  std::vector<uint8_t> representativeList(byteClassCount);
+  for (size_t ch = 256; ch-- > 0;) representativeList[byteClassMap[ch]] = ch;
+
+  // Subset construction
+  std::map<StateSet, size_t> dfaStateMap;
+  std::vector<const StateSet*> dfaStateList;
+  std::vector<std::vector<size_t>> dfaTransitionList;
+  std::queue<size_t> workList;
+  auto getDFAState = [&](StateSet stateSet) {
+    if (stateSet.empty()) return LexerDFA::DEAD;
+    auto [it, isInserted] =
+        dfaStateMap.try_emplace(std::move(stateSet), dfaStateList.size());
+    if (isInserted) {
+      dfaStateList.push_back(&it->first);
+      dfaTransitionList.emplace_back(byteClassCount, LexerDFA::DEAD);
+      workList.push(it->second);
+    }
+    return static_cast<LexerDFA::StateType>(it->second);
+  };
+  getDFAState(closure(startStateList));
+  while (!workList.empty()) {
+    size_t dfaState = workList.front();
+    workList.pop();
+    for (size_t byteClass = 0; byteClass < byteClassCount; byteClass++) {
+      const size_t ch = representativeList[byteClass];
+      StateSet nextSet;
+      for (size_t state : *dfaStateList[dfaState])
+        for (const auto& [byteSet, to] : stateList[state].edgeList)
+          if (byteSet.test(ch)) nextSet.push_back(to);
+      std::ranges::sort(nextSet);
+      nextSet.erase(std::unique(nextSet.begin(), nextSet.end()), nextSet.end());
+      auto next = getDFAState(closure(std::move(nextSet)));
+      dfaTransitionList[dfaState][byteClass] = next;
+    }
+  }
+
+  // Accepted terminals of each state
+  std::vector<std::vector<uint32_t>> dfaAcceptList(dfaStateList.size());
+  for (size_t dfaState = 0; dfaState < dfaStateList.size(); dfaState++) {
+    auto& acceptList = dfaAcceptList[dfaState];
+    for (size_t state : *dfaStateList[dfaState]) {
+      size_t terminal = stateList[state].acceptedTerminal;
+      if (terminal != NOT_ACCEPTED && effectiveCoveredList[terminal])
+        acceptList.push_back(terminal);
+    }
+    std::ranges::sort(acceptList);
+    acceptList.erase(std::unique(acceptList.begin(), acceptList.end()),
+                     acceptList.end());
+    const std::vector<uint32_t> unexcludedList = acceptList;
+    std::erase_if(acceptList, [&](uint32_t terminal) {
+      if (!effectiveExcludeMap.contains(terminal)) return false;
+      return std::ranges::any_of(effectiveExcludeMap.at(terminal),
+                                 [&](size_t excluded) {
+                                   return std::ranges::binary_search(
+                                       unexcludedList, excluded);
+                                 });
+    });
+  }
+
+  // States which can not reach any accepting state are dead, so the runtime
+  // can stop as early as possible
+  const size_t dfaStateCount = dfaStateList.size();
+  {
+    std::vector<std::vector<size_t>> reverseTransitionList(dfaStateCount);
+    std::vector<bool> liveList(dfaStateCount);
+    std::stack<size_t> stack;
+    for (size_t dfaState = 0; dfaState < dfaStateCount; dfaState++) {
+      for (auto next : dfaTransitionList[dfaState])
+        if (next != LexerDFA::DEAD)
+          reverseTransitionList[next].push_back(dfaState);
+      if (!dfaAcceptList[dfaState].empty()) {
+        liveList[dfaState] = true;
+        stack.push(dfaState);
+      }
+    }
+    while (!stack.empty()) {
+      size_t dfaState = stack.top();
+      stack.pop();
+      for (size_t previous : reverseTransitionList[dfaState]) {
+        if (liveList[previous]) continue;
+        liveList[previous] = true;
+        stack.push(previous);
+      }
+    }
+    for (auto& transitionList : dfaTransitionList)
+      for (auto& next : transitionList)
+        if (next != LexerDFA::DEAD && !liveList[next]) next = LexerDFA::DEAD;
+  }
+
+  // Minimization (Moore). States are first split by accepted terminals, then
+  // by the blocks of their transitions until nothing changes.
+  std::vector<size_t> blockList(dfaStateCount);
+  size_t blockCount = 0;
+  {
+    std::map<std::vector<uint32_t>, size_t> initialBlockMap;
+    for (size_t dfaState = 0; dfaState < dfaStateCount; dfaState++) {
+      auto [it, _] = initialBlockMap.try_emplace(dfaAcceptList[dfaState],
+                                                 initialBlockMap.size());
+      blockList[dfaState] = it->second;
+    }
+    blockCount = initialBlockMap.size();
+  }
+  while (true) {
+    std::map<std::vector<size_t>, size_t> signatureMap;
+    std::vector<size_t> nextBlockList(dfaStateCount);
+    for (size_t dfaState = 0; dfaState < dfaStateCount; dfaState++) {
+      std::vector<size_t> signature{blockList[dfaState]};
+      for (auto next : dfaTransitionList[dfaState])
+        signature.push_back(next == LexerDFA::DEAD ? LexerDFA::DEAD
+                                                   : blockList[next]);
+      auto [it, _] =
+          signatureMap.try_emplace(std::move(signature), signatureMap.size());
+      nextBlockList[dfaState] = it->second;
+    }
+    blockList = std::move(nextBlockList);
+    if (signatureMap.size() == blockCount) break;
+    blockCount = signatureMap.size();
+  }
+
+  // Renumber blocks so the start state is 0
+  std::vector<size_t> blockIndexList(blockCount, LexerDFA::DEAD);
+  std::vector<size_t> blockRepresentativeList;
+  std::queue<size_t> renumberQueue({0});
+  blockIndexList[blockList[0]] = 0;
+  blockRepresentativeList.push_back(0);
+  while (!renumberQueue.empty()) {
+    size_t dfaState = renumberQueue.front();
+    renumberQueue.pop();
+    for (auto next : dfaTransitionList[dfaState]) {
+      if (next == LexerDFA::DEAD ||
+          blockIndexList[blockList[next]] != LexerDFA::DEAD)
+        continue;
+      blockIndexList[blockList[next]] = blockRepresentativeList.size();
+      blockRepresentativeList.push_back(next);
+      renumberQueue.push(next);
+    }
+  }
+
+  LexerDFA dfa;
+  std::ranges::copy(byteClassMap, dfa.byteClassMap.begin());
+  dfa.byteClassCount = byteClassCount;
+  dfa.acceptOffsetList.push_back(0);
+  for (size_t dfaState : blockRepresentativeList) {
+    for (auto next : dfaTransitionList[dfaState])
+      dfa.transitionTable.push_back(
+          next == LexerDFA::DEAD
+              ? LexerDFA::DEAD
+              : static_cast<LexerDFA::StateType>(
+                    blockIndexList[blockList[next]]));
+    const auto& acceptList = dfaAcceptList[dfaState];
+    dfa.acceptList.insert(dfa.acceptList.end(), acceptList.begin(),
+                          acceptList.end());
+    dfa.acceptOffsetList.push_back(dfa.acceptList.size());
+  }
+  dfa.coveredList = effectiveCoveredList;
+  dfa.wordTerminal = wordTerminal;
+  dfa.wordExcludeList = std::move(wordExcludeList);
+  return dfa;
+}
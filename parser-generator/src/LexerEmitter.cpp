@@ -0,0 +1,136 @@
+#include "LexerEmitter.hpp"
+
+#include <map>
+#include <string>
+#include <vector>
+
+using namespace ParserGenerator;
+using LexerDFA = GeneratedParser::LexerDFA;
+
+namespace {
+constexpr size_t CASE_PER_LINE = 8;
+
+std::string createFunctionName(size_t terminal, const std::string& name) {
+  return name.empty() ? "scanTerminal" + std::to_string(terminal)
+                      : "scan" + name;
+}
+
+void emitReturn(std::ostream& os, LexerDFA::StateType state,
+                const std::string& indent) {
+  os << indent << "state = " << state << ";\n"
+     << indent << "goto exit;\n";
+}
+}  // namespace
+
+/*
+ * A state is entered at its enter label, which consumes the byte, and is
+ * resumed at its state label. Only the bytes which do not go to the most
+ * common target are listed in the switch. The accepted length is kept in a
+ * local until the exit, which is the only place it is stored.
+ */
+void LexerEmitter::emitScanFunction(std::ostream& os,
+                                    const std::string& function,
+                                    const LexerDFA& dfa) {
+  const auto stateCount = static_cast<LexerDFA::StateType>(dfa.getStateCount());
+  const std::vector<bool> acceptedList = dfa.createAcceptedList(0);
+  std::vector<bool> enteredList(stateCount);
+  for (LexerDFA::StateType state = 0; state < stateCount; state++)
+    for (size_t byte = 0; byte < 256; byte++)
+      if (const auto next = dfa.next(state, byte); next != LexerDFA::DEAD)
+        enteredList[next] = true;
+
+  os << "StateType " << function
+     << "(StateType state, const char* data, size_t size,\n"
+     << "    size_t* length, size_t* acceptedLength) {\n"
+     << "  size_t pos = 0;\n"
+     << "  size_t accepted = 0;\n"
+     << "  switch (state) {\n";
+  for (LexerDFA::StateType state = 0; state < stateCount; state++)
+    os << "    case " << state << ":\n"
+       << "      goto state" << state << ";\n";
+  os << "    default:\n"
+     << "      *length = 0;\n"
+     << "      return state;\n"
+     << "  }\n";
+
+  for (LexerDFA::StateType state = 0; state < stateCount; state++) {
+    if (enteredList[state]) {
+      os << "enter" << state << ":\n";
+      os << (acceptedList[state] ? "  accepted = ++pos;\n"
+                                 : "  pos++;\n");
+    }
+    os << "state" << state << ":\n"
+       << "  if (pos == size) {\n";
+    emitReturn(os, state, "    ");
+    os << "  }\n";
+
+    std::map<LexerDFA::StateType, std::vector<size_t>> byteListMap;
+    for (size_t byte = 0; byte < 256; byte++)
+      byteListMap[dfa.next(state, byte)].push_back(byte);
+    auto defaultIt = byteListMap.begin();
+    for (auto it = byteListMap.begin(); it != byteListMap.end(); it++)
+      if (it->second.size() > defaultIt->second.size()) defaultIt = it;
+    auto emitTarget = [&](LexerDFA::StateType next) {
+      if (next == LexerDFA::DEAD)
+        emitReturn(os, state, "      ");
+      else
+        os << "      goto enter" << next << ";\n";
+    };
+
+    os << "  switch (static_cast<unsigned char>(data[pos])) {\n";
+    for (auto it = byteListMap.begin(); it != byteListMap.end(); it++) {
+      if (it == defaultIt) continue;
+      const auto& byteList = it->second;
+      for (size_t i = 0; i < byteList.size(); i++)
+        os << (i % CASE_PER_LINE == 0 ? "    " : " ") << "case "
+           << byteList[i]
+           << (i % CASE_PER_LINE == CASE_PER_LINE - 1 ||
+                       i == byteList.size() - 1
+                   ? ":\n"
+                   : ":");
+      emitTarget(it->first);
+    }
+    os << "    default:\n";
+    emitTarget(defaultIt->first);
+    os << "  }\n";
+  }
+  // Entering a state consumes a byte, so 0 is never an accepted length
+  os << "exit:\n"
+     << "  *length = pos;\n"
+     << "  if (accepted != 0 && acceptedLength != nullptr)\n"
+     << "    *acceptedLength = accepted;\n"
+     << "  return state;\n"
+     << "}\n\n";
+}
+
+void LexerEmitter::emit(std::ostream& os, const std::string& header) const {
+  os << "// Generated by parser-generator --emit-lexer, do not edit\n"
+     << "#include <span>\n\n"
+     << "#include \"LexerDFA.parser.hpp\"\n"
+     << "#include \"" << header << "\"\n\n"
+     << "namespace GeneratedParser {\n"
+     << "namespace {\n"
+     << "using StateType = LexerDFA::StateType;\n\n";
+  for (const auto& entry : entryList)
+    emitScanFunction(os, createFunctionName(entry.terminal, entry.name),
+                     entry.dfa);
+  os << "}  // namespace\n\n"
+     << "std::span<const LexerDFA::EmittedScan> getEmittedScanList() {\n";
+  if (entryList.empty()) {
+    os << "  return {};\n";
+  } else {
+    os << "  static constexpr LexerDFA::EmittedScan emittedScanList[] = {\n";
+    for (const auto& entry : entryList)
+      os << "      {"
+         << (entry.name.empty() ? std::to_string(entry.terminal)
+                                : "Terminal::" + entry.name)
+         << ", 0x" << std::hex
+         << entry.dfa.getFingerprint(entry.dfa.createAcceptedList(0))
+         << std::dec << "ULL, "
+         << createFunctionName(entry.terminal, entry.name) << "},\n";
+    os << "  };\n"
+       << "  return emittedScanList;\n";
+  }
+  os << "}\n"
+     << "}  // namespace GeneratedParser\n";
+}
@@ -1,5 +1,8 @@
+#include <algorithm>
+#include <filesystem>
 #include <fstream>
 #include <iostream>
+#include <iterator>
 #include <list>
 #include <map>
 #include <memory>
@@ -11,10 +14,17 @@
 #include <unordered_set>
 #include <utility>
 
+#include "ByteSet.parser.hpp"
+#include "FirstByteSet.hpp"
 #include "LLTable.hpp"
 #include "LLTablePasses.hpp"
 #include "Lexer.hpp"
+#include "LexerDFA.parser.hpp"
+#include "LexerDFABuilder.hpp"
+#include "LexerEmitter.hpp"
 #include "Parser.hpp"
+#include "PerfectHashBuilder.hpp"
+#include "ScannerShape.hpp"
 #include "Serializer.parser.hpp"
 
 using namespace GeneratedParser::Serializer;
@@ -22,6 +32,7 @@ using namespace GeneratedParser::Serializer;
 using TerminalType = ParserGenerator::TerminalType;
 using BNFParser = ParserGenerator::BNFParser;
 using BNFLexer = ParserGenerator::BNFLexer;
+using ScannerShape = ParserGenerator::ScannerShape;
 
 using LLTable = ParserGenerator::LLTable<size_t, size_t>;
 using Production = LLTable::Production;
@@ -56,6 +67,21 @@ struct BuildInfo {
     return nonTerminalToExcludeCache.at(nonTerminalIndex);
   }
 
+  // Split [/Regex/ NonTerminal] into the regex and the terminals to exclude
+  std::pair<std::string_view, const std::list<size_t>&> getRegexExclude(
+      const TerminalType& terminal) {
+    std::ranges::split_view terminalSplit(terminal.value, ' ');
+    auto terminalSplitIt = terminalSplit.begin();
+    auto regex = std::string_view{(*terminalSplitIt).begin(),
+                                  (*terminalSplitIt).end()};
+    terminalSplitIt++;
+    if (terminalSplitIt == terminalSplit.end())
+      throw std::runtime_error("Not valid regex exclude expression");
+    auto excludeNonTerminal =
+        std::string{(*terminalSplitIt).begin(), (*terminalSplitIt).end()};
+    return {regex, getDirectLeftCornerListOfNonTerminal(excludeNonTerminal)};
+  }
+
   std::list<Production>& getGrammar() { return grammar; }
 
   const std::list<TerminalType>& getTerminalList() { return terminalList; }
@@ -63,13 +89,145 @@ struct BuildInfo {
   const std::unordered_map<std::string, size_t>& getNonTerminalIndexMap() {
     return nonTerminalIndexMap;
   }
+
+  /*
+   * A terminal is named after the non-terminal whose only production is the
+   * terminal, e.g. Identifier. It must be called before the grammar is
+   * transformed.
+   */
+  [[nodiscard]] std::map<size_t, std::string> createTerminalNameMap() const {
+    std::unordered_map<size_t, size_t> productionCountMap;
+    for (const auto& production : grammar)
+      productionCountMap[production.left]++;
+    std::map<size_t, std::string> terminalNameMap;
+    for (const auto& [nonTerminal, index] : nonTerminalIndexMap) {
+      if (productionCountMap[index] != 1) continue;
+      const auto& production = *std::ranges::find(grammar, index,
+                                                  &Production::left);
+      if (production.right.size() == 1 &&
+          production.right.front().type == Symbol::Terminal)
+        terminalNameMap.emplace(production.right.front().getTerminal(),
+                                nonTerminal);
+    }
+    return terminalNameMap;
+  }
 };
 
+// Terminals of a few shapes are matched by a scanner instead of the regex
+ScannerShape detectShape(BuildInfo& buildInfo, const TerminalType& terminal) {
+  switch (terminal.type) {
+    case TerminalType::Regex:
+      return ScannerShape::detect(terminal.value);
+    case TerminalType::RegexExclude: {
+      // Only the identifier scanner excludes terminals
+      auto shape =
+          ScannerShape::detect(buildInfo.getRegexExclude(terminal).first);
+      return shape.type == ScannerShape::Identifier ? shape : ScannerShape{};
+    }
+    default:
+      return {};
+  }
+}
+
+/*
+ * ASCII identifiers are decided by a DFA without the excluded ASCII strings,
+ * e.g. keywords. The other excluded terminals are left to the runtime.
+ *
+ * @return {std::pair<std::list<size_t>, std::list<size_t>>}  : The terminals
+ * excluded by the DFA, and the ones excluded at runtime
+ */
+std::pair<std::list<size_t>, std::list<size_t>> splitIdentifierExcludeList(
+    BuildInfo& buildInfo, const TerminalType& terminal) {
+  std::list<size_t> dfaExcludeList;
+  std::list<size_t> runtimeExcludeList;
+  if (terminal.type == TerminalType::RegexExclude) {
+    const auto& terminalList = buildInfo.getTerminalList();
+    auto [_, excludeList] = buildInfo.getRegexExclude(terminal);
+    for (const size_t& excluded : excludeList) {
+      const auto& excludedTerminal = *std::next(terminalList.begin(), excluded);
+      const bool isAsciiString =
+          excludedTerminal.type == TerminalType::String &&
+          std::ranges::all_of(excludedTerminal.value, [](const char& ch) {
+            return static_cast<unsigned char>(ch) < 0x80;
+          });
+      (isAsciiString ? dfaExcludeList : runtimeExcludeList)
+          .push_back(excluded);
+    }
+  }
+  return {dfaExcludeList, runtimeExcludeList};
+}
+
+/**
+ * Compile L(regex) \ L(excluded terminals) into a DFA of its own, which
+ * accepts terminal 0 where the regex does and no excluded terminal does. So
+ * a matcher decides the terminal in one pass.
+ *
+ * @return {GeneratedParser::LexerDFA}  : Empty if the regex or an excluded
+ * terminal can not be compiled
+ */
+GeneratedParser::LexerDFA buildDifferenceDFA(
+    BuildInfo& buildInfo, std::string_view regex,
+    const std::list<size_t>& excludeList) {
+  ParserGenerator::LexerDFABuilder builder(false);
+  std::list<size_t> localExcludeList;
+  for (const size_t& excluded : excludeList) {
+    const size_t local = localExcludeList.size() + 1;
+    const auto& terminal =
+        *std::next(buildInfo.getTerminalList().begin(), excluded);
+    switch (terminal.type) {
+      case TerminalType::String:
+        builder.addString(local, terminal.value);
+        break;
+      case TerminalType::Regex:
+        if (!builder.addRegex(local, terminal.value)) return {};
+        break;
+      default:
+        return {};
+    }
+    localExcludeList.push_back(local);
+  }
+  if (!builder.addRegexExclude(0, regex, localExcludeList)) return {};
+  return builder.build();
+}
+
+/**
+ * @return {GeneratedParser::LexerDFA}  : The DFA a terminal is matched with
+ * at runtime, or empty if it has none
+ */
+GeneratedParser::LexerDFA buildMatcherDFA(BuildInfo& buildInfo,
+                                          const TerminalType& terminal) {
+  const auto shape = detectShape(buildInfo, terminal);
+  if (shape.type == ScannerShape::Identifier)
+    return buildDifferenceDFA(
+        buildInfo, shape.createAsciiRegex(),
+        splitIdentifierExcludeList(buildInfo, terminal).first);
+  if (shape.type != ScannerShape::None ||
+      terminal.type != TerminalType::RegexExclude)
+    return {};
+  auto [regex, excludeList] = buildInfo.getRegexExclude(terminal);
+  return buildDifferenceDFA(buildInfo, regex, excludeList);
+}
+
+// Matcher type of a terminal with a DFA of its own, after the scanners
+constexpr char DFA_MATCHER = 7;
+
 template <>
 class GeneratedParser::Serializer::Serializer<BuildInfo> : public ISerializer {
  protected:
   BuildInfo& buildInfo;
 
+  void serializeIdentifier(BinaryOfStream& os, const TerminalType& terminal,
+                           const ScannerShape& shape) const {
+    // The DFA knows the ASCII chars an identifier starts with
+    os.put(shape.type);
+    Serializer<std::string>(shape.extraPart).serialize(os);
+    Serializer<std::list<size_t>>(
+        splitIdentifierExcludeList(buildInfo, terminal).second)
+        .serialize(os);
+    Serializer<GeneratedParser::LexerDFA>(buildMatcherDFA(buildInfo, terminal))
+        .serialize(os);
+  }
+
  public:
   explicit Serializer(BuildInfo& buildInfo) : buildInfo(buildInfo) {}
 
@@ -78,6 +236,25 @@ class GeneratedParser::Serializer::Serializer<BuildInfo> : public ISerializer {
     Serializer<size_t>(terminalList.size()).serialize(os);
     for (const auto& item : terminalList) {
       os.put(BOS);
+      const auto shape = detectShape(buildInfo, item);
+      if (shape.type == ScannerShape::Identifier) {
+        serializeIdentifier(os, item, shape);
+        continue;
+      }
+      if (shape.type != ScannerShape::None) {
+        os.put(shape.type);
+        os.put(shape.first);
+        if (shape.type == ScannerShape::UntilSequence) os.put(shape.second);
+        continue;
+      }
+      if (item.type == TerminalType::RegexExclude) {
+        const auto dfa = buildMatcherDFA(buildInfo, item);
+        if (!dfa.empty()) {
+          os.put(DFA_MATCHER);
+          Serializer<GeneratedParser::LexerDFA>(dfa).serialize(os);
+          continue;
+        }
+      }
       os.put(item.type);
       switch (item.type) {
         case TerminalType::String:
@@ -85,20 +262,9 @@ class GeneratedParser::Serializer::Serializer<BuildInfo> : public ISerializer {
           Serializer<std::string>(item.value).serialize(os);
           break;
         case TerminalType::RegexExclude: {
-          std::ranges::split_view terminalSplit(item.value, ' ');
-          auto terminalSplitIt = terminalSplit.begin();
-          auto regex = std::string_view{(*terminalSplitIt).begin(),
-                                        (*terminalSplitIt).end()};
+          auto [regex, excludeList] = buildInfo.getRegexExclude(item);
           Serializer<std::string_view>(regex).serialize(os);
-          terminalSplitIt++;
-          if (terminalSplitIt == terminalSplit.end())
-            throw std::runtime_error("Not valid regex exclude expression");
-          auto excludeNonTerminal =
-              std::string{(*terminalSplitIt).begin(), (*terminalSplitIt).end()};
-          Serializer<std::list<size_t>>(
-              buildInfo.getDirectLeftCornerListOfNonTerminal(
-                  excludeNonTerminal))
-              .serialize(os);
+          Serializer<std::list<size_t>>(excludeList).serialize(os);
           break;
         }
         default:
@@ -175,10 +341,82 @@ BuildInfo transformToSizeTProductionList(
   return buildInfo;
 }
 
+// Compile every terminal that can be matched byte by byte into one DFA
+GeneratedParser::LexerDFA buildLexerDFA(BuildInfo& buildInfo) {
+  ParserGenerator::LexerDFABuilder builder;
+  size_t index = 0;
+  for (const auto& terminal : buildInfo.getTerminalList()) {
+    switch (terminal.type) {
+      case TerminalType::String:
+        builder.addString(index, terminal.value);
+        break;
+      case TerminalType::Regex:
+        // Left to the scanner
+        if (detectShape(buildInfo, terminal).type == ScannerShape::None)
+          builder.addRegex(index, terminal.value);
+        break;
+      case TerminalType::RegexExclude: {
+        auto [regex, excludeList] = buildInfo.getRegexExclude(terminal);
+        builder.addRegexExclude(index, regex, excludeList);
+        break;
+      }
+      default:
+        throw std::runtime_error("Unknown terminal");
+    }
+    index++;
+  }
+  return builder.build();
+}
+
+// The lexer only tries a matcher when the current byte is in its set
+std::vector<GeneratedParser::ByteSet> buildFirstByteSetList(
+    BuildInfo& buildInfo) {
+  std::vector<GeneratedParser::ByteSet> firstByteSetList;
+  for (const auto& terminal : buildInfo.getTerminalList()) {
+    switch (terminal.type) {
+      case TerminalType::String:
+        firstByteSetList.push_back(
+            ParserGenerator::createFirstByteSet(terminal.value));
+        break;
+      case TerminalType::Regex:
+        firstByteSetList.push_back(ParserGenerator::createFirstByteSet(
+            GeneratedParser::Regex(terminal.value)));
+        break;
+      case TerminalType::RegexExclude: {
+        auto [regex, _] = buildInfo.getRegexExclude(terminal);
+        firstByteSetList.push_back(ParserGenerator::createFirstByteSet(
+            GeneratedParser::Regex(regex)));
+        break;
+      }
+      default:
+        throw std::runtime_error("Unknown terminal");
+    }
+  }
+  return firstByteSetList;
+}
+
+// Look up string terminals by text, e.g. to tell keywords from identifiers
+GeneratedParser::PerfectHash buildStringHash(BuildInfo& buildInfo) {
+  ParserGenerator::PerfectHashBuilder builder;
+  uint32_t index = 0;
+  for (const auto& terminal : buildInfo.getTerminalList()) {
+    if (terminal.type == TerminalType::String)
+      builder.add(terminal.value, index);
+    index++;
+  }
+  return builder.build();
+}
+
 void outputToStream(const LLTable& table, BuildInfo& buildInfo,
                     BinaryOfStream& output) {
+  const auto lexerDFA = buildLexerDFA(buildInfo);
+  const auto firstByteSetList = buildFirstByteSetList(buildInfo);
+  const auto stringHash = buildStringHash(buildInfo);
   BinarySerializer serializer;
   serializer.add(buildInfo);
+  serializer.add(lexerDFA);
+  serializer.add(firstByteSetList);
+  serializer.add(stringHash);
   serializer.add(table.getStart());
   serializer.add(table.getTable());
   serializer.serialize(output);
@@ -186,6 +424,7 @@ void outputToStream(const LLTable& table, BuildInfo& buildInfo,
 
 void outputHeader(
     const std::unordered_map<std::string, size_t>& nonTerminalIndexMap,
+    const std::map<size_t, std::string>& terminalNameMap,
     const std::string& fileName) {
   std::ofstream headerFile(fileName);
   headerFile << "namespace GeneratedParser {" << std::endl;
@@ -193,9 +432,34 @@ void outputHeader(
     headerFile << "constexpr inline size_t " << nonTerminal << " = " << index
                << ";" << std::endl;
   }
+  headerFile << "namespace Terminal {" << std::endl;
+  for (const auto& [index, name] : terminalNameMap) {
+    headerFile << "constexpr inline size_t " << name << " = " << index << ";"
+               << std::endl;
+  }
+  headerFile << "}" << std::endl;
   headerFile << "}";
 }
 
+// Write the DFAs of the matchers as a C++ scanner, see LexerEmitter
+void outputLexer(BuildInfo& buildInfo,
+                 const std::map<size_t, std::string>& terminalNameMap,
+                 const std::string& header, const std::string& fileName) {
+  ParserGenerator::LexerEmitter emitter;
+  size_t index = 0;
+  for (const auto& terminal : buildInfo.getTerminalList()) {
+    auto dfa = buildMatcherDFA(buildInfo, terminal);
+    if (!dfa.empty()) {
+      const auto it = terminalNameMap.find(index);
+      emitter.add(index, it == terminalNameMap.end() ? "" : it->second,
+                  std::move(dfa));
+    }
+    index++;
+  }
+  std::ofstream lexerFile(fileName);
+  emitter.emit(lexerFile, header);
+}
+
 std::unordered_map<std::string, std::string> parseOption(
     int argc, const char** argv,
     std::unordered_map<std::string, std::string>&& defaultValue) {
@@ -231,6 +495,7 @@ int main(int argc, const char** argv) {
   BNFParser parser(BNFLexer::create(bnfFile));
 
   BuildInfo buildInfo = transformToSizeTProductionList(parser.parse());
+  const auto terminalNameMap = buildInfo.createTerminalNameMap();
 
   size_t startIndex = buildInfo.getNonTerminalIndexMap().at("Start");
   size_t index = buildInfo.getNonTerminalIndexMap().size();
@@ -248,5 +513,16 @@ int main(int argc, const char** argv) {
   outputToStream(table, buildInfo, of);
 
   if (options.contains("--header"))
-    outputHeader(buildInfo.getNonTerminalIndexMap(), options.at("--header"));
+    outputHeader(buildInfo.getNonTerminalIndexMap(), terminalNameMap,
+                 options.at("--header"));
+
+  // The terminals are named in the header, so the scanner needs both
+  if (options.contains("--emit-lexer")) {
+    if (!options.contains("--header"))
+      throw std::runtime_error("--emit-lexer needs --header");
+    outputLexer(
+        buildInfo, terminalNameMap,
+        std::filesystem::path(options.at("--header")).filename().string(),
+        options.at("--emit-lexer"));
+  }
 }
@@ -0,0 +1,58 @@
+#include "PerfectHashBuilder.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <stdexcept>
+
+using namespace ParserGenerator;
+using PerfectHash = GeneratedParser::PerfectHash;
+
+namespace {
+// SplitMix64, so the generated table is the same on every run
+uint64_t createMultiplier(uint64_t seed) {
+  uint64_t z = seed + 0x9E3779B97F4A7C15;
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EB;
+  return (z ^ (z >> 31)) | 1;
+}
+}  // namespace
+
+bool PerfectHashBuilder::tryBuild(PerfectHash& perfectHash) const {
+  const size_t slotCount = size_t{1} << (64 - perfectHash.shift);
+  for (uint64_t attempt = 0; attempt < ATTEMPT_COUNT; attempt++) {
+    perfectHash.multiplier = createMultiplier(attempt);
+    std::vector<bool> usedList(slotCount);
+    bool isPerfect = true;
+    for (const auto& [key, _] : entryList) {
+      size_t slot = perfectHash.getSlot(key);
+      if (usedList[slot]) {
+        isPerfect = false;
+        break;
+      }
+      usedList[slot] = true;
+    }
+    if (!isPerfect) continue;
+    perfectHash.keyList.assign(slotCount, {});
+    perfectHash.valueList.assign(slotCount, PerfectHash::NOT_FOUND);
+    for (const auto& [key, value] : entryList) {
+      size_t slot = perfectHash.getSlot(key);
+      perfectHash.keyList[slot] = key;
+      perfectHash.valueList[slot] = value;
+    }
+    return true;
+  }
+  return false;
+}
+
+PerfectHash PerfectHashBuilder::build() const noexcept(false) {
+  PerfectHash perfectHash;
+  if (entryList.empty()) return perfectHash;
+  // At least two slots, so the shift is less than 64
+  const auto bitCount =
+      std::max<uint32_t>(1, std::bit_width(entryList.size() - 1));
+  for (uint32_t growth = 0; growth <= MAX_GROWTH; growth++) {
+    perfectHash.shift = 64 - (bitCount + growth);
+    if (tryBuild(perfectHash)) return perfectHash;
+  }
+  throw std::runtime_error("Can not find a perfect hash");
+}
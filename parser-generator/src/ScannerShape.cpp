@@ -0,0 +1,85 @@
+#include "ScannerShape.hpp"
+
+#include <cctype>
+#include <regex>
+#include <string>
+
+#include "Unicode.parser.hpp"
+
+using namespace ParserGenerator;
+
+namespace {
+// A char in the regex, which may be escaped
+const std::string CHAR = R"((\\.|[^\\]))";
+
+// A char in a char class, which is not a range or a property
+const std::string SET_CHAR = R"((\\[^p]|[^\\\]\^\-]))";
+
+char unescape(const std::string& ch) {
+  if (ch.size() == 1) return ch.front();
+  return ch.back() == 'n' ? '\n' : ch.back();
+}
+
+std::string unescapeAll(const std::string& str) {
+  std::string result;
+  for (size_t i = 0; i < str.size(); i++) {
+    const size_t length = str[i] == '\\' ? 2 : 1;
+    result.push_back(unescape(str.substr(i, length)));
+    i += length - 1;
+  }
+  return result;
+}
+}  // namespace
+
+std::string ScannerShape::createAsciiRegex() const {
+  using GeneratedParser::Unicode::Property;
+  auto createCharSet = [](Property property, std::string_view extra) {
+    std::string charSet = "[";
+    for (int ch = 0; ch < 0x80; ch++) {
+      if (!(GeneratedParser::Unicode::getAsciiProperties(ch) & property) &&
+          extra.find(static_cast<char>(ch)) == std::string_view::npos)
+        continue;
+      // Escape everything but letters and digits, which could be special
+      if (ch == '\n')
+        charSet += "\\n";
+      else if (std::isalnum(ch))
+        charSet.push_back(static_cast<char>(ch));
+      else
+        charSet += {'\\', static_cast<char>(ch)};
+    }
+    return charSet + "]";
+  };
+  return "/" + createCharSet(Property::IdStart, extraStart) +
+         createCharSet(Property::IdContinue, extraPart) + "*/";
+}
+
+ScannerShape ScannerShape::detect(std::string_view regexStr) {
+  static const std::regex untilByte("^/\\[\\^" + CHAR + "\\]\\*/$");
+  static const std::regex untilSequence("^/\\(\\[\\^" + CHAR + "\\]\\|\\(" +
+                                        CHAR + "\\(\\?!" + CHAR +
+                                        "\\)\\)\\)\\*/$");
+  static const std::regex quoted("^/" + CHAR + R"(\(\[\^)" + CHAR +
+                                 R"(\\\\\]\|\(\\\\\.\)\)\*)" + CHAR + "/$");
+  static const std::regex identifier(
+      "^/\\[(" + SET_CHAR + R"(*)\\p\{ID_Start\}\]\[()" + SET_CHAR +
+      R"(*)\\p\{ID_Continue\}\]\*/$)");
+
+  const std::string str(regexStr);
+  std::smatch match;
+  if (std::regex_match(str, match, untilByte))
+    return {UntilByte, unescape(match[1])};
+  if (std::regex_match(str, match, untilSequence) &&
+      unescape(match[1]) == unescape(match[2]))
+    return {UntilSequence, unescape(match[1]), unescape(match[3])};
+  if (std::regex_match(str, match, quoted) &&
+      unescape(match[1]) == unescape(match[2]) &&
+      unescape(match[2]) == unescape(match[3]))
+    return {Quoted, unescape(match[1])};
+  if (std::regex_match(str, match, identifier)) {
+    ScannerShape shape{Identifier};
+    shape.extraStart = unescapeAll(match[1]);
+    shape.extraPart = unescapeAll(match[3]);
+    return shape;
+  }
+  return {};
+}
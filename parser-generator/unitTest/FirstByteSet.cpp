@@ -0,0 +1,23 @@
+#include "FirstByteSet.hpp"
+
+#include <gtest/gtest.h>
+
+using namespace ParserGenerator;
+using Regex = GeneratedParser::Regex;
+
+TEST(FirstByteSet, String) {
+  const ByteSet byteSet = createFirstByteSet("if");
+  EXPECT_TRUE(byteSet.test('i'));
+  EXPECT_EQ(byteSet.count(), 1);
+  EXPECT_TRUE(createFirstByteSet("").all());
+}
+
+TEST(FirstByteSet, Regex) {
+  const ByteSet byteSet = createFirstByteSet(Regex(R"(/(\d|a)b*/)"));
+  EXPECT_TRUE(byteSet.test('0'));
+  EXPECT_TRUE(byteSet.test('9'));
+  EXPECT_TRUE(byteSet.test('a'));
+  EXPECT_FALSE(byteSet.test('b'));
+  // Nullable
+  EXPECT_TRUE(createFirstByteSet(Regex("/a*/")).all());
+}
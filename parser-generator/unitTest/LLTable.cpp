@@ -0,0 +1,84 @@
+#include "LLTable.parser.hpp"
+
+#include <gtest/gtest.h>
+
+#include <list>
+#include <vector>
+
+using namespace GeneratedParser;
+using Symbol = GeneratedLLTable::Symbol;
+using SerializedSymbol = GeneratedLLTable::SerializedSymbol;
+
+namespace {
+class TestLLTable : public GeneratedLLTable {
+ public:
+  using GeneratedLLTable::build;
+};
+
+SerializedSymbol terminal(size_t value) {
+  return SerializedSymbol::createTerminal(value);
+}
+
+SerializedSymbol nonTerminal(size_t value) {
+  return SerializedSymbol::createNonTerminal(value);
+}
+
+const SerializedSymbol END(SerializedSymbol::End);
+}  // namespace
+
+// 0 = "a" 1 | 1 "c" 2 | END, 1 = "b" | "c" "b", where 2 is only on the right
+TEST(LLTable, Predict) {
+  const std::list<SerializedSymbol> production0{terminal(0), nonTerminal(1)};
+  const std::list<SerializedSymbol> production1{nonTerminal(1), terminal(2),
+                                                nonTerminal(2)};
+  const std::list<SerializedSymbol> production2{terminal(1)};
+  const std::list<SerializedSymbol> production3{terminal(2), terminal(1)};
+  GeneratedLLTable::SerializedTable serializedTable;
+  serializedTable[0] = {{terminal(0), production0},
+                        {terminal(1), production1},
+                        {terminal(2), production1},
+                        {END, {END}}};
+  serializedTable[1] = {{terminal(1), production2},
+                        {terminal(2), production3}};
+  TestLLTable table;
+  table.build(serializedTable);
+
+  EXPECT_EQ(sizeof(Symbol), 4);
+  EXPECT_EQ(table.getNonTerminalCount(), 3);
+  // Both lookaheads of 0 = 1 "c" 2 share the production
+  EXPECT_EQ(table.getProductionCount(), 5);
+  const auto nonTerminal0 = Symbol::createNonTerminal(0);
+  const auto prediction =
+      table.predict(nonTerminal0, Symbol::createTerminal(1));
+  EXPECT_EQ(prediction.data(),
+            table.predict(nonTerminal0, Symbol::createTerminal(2)).data());
+  EXPECT_EQ(std::vector<Symbol>(prediction.begin(), prediction.end()),
+            (std::vector<Symbol>{Symbol::createNonTerminal(1),
+                                 Symbol::createTerminal(2),
+                                 Symbol::createNonTerminal(2)}));
+  EXPECT_EQ(table.predict(nonTerminal0, GeneratedLLTable::END).front(),
+            GeneratedLLTable::END);
+
+  const auto nonTerminal1 = Symbol::createNonTerminal(1);
+  EXPECT_TRUE(table.findPrediction(nonTerminal1, Symbol::createTerminal(0))
+                  .empty());
+  EXPECT_TRUE(
+      table.findPrediction(nonTerminal1, GeneratedLLTable::END).empty());
+  EXPECT_TRUE(table.findPrediction(nonTerminal1, Symbol::createTerminal(9))
+                  .empty());
+  EXPECT_TRUE(table
+                  .findPrediction(Symbol::createNonTerminal(2),
+                                  Symbol::createTerminal(0))
+                  .empty());
+  EXPECT_THROW(table.predict(nonTerminal1, Symbol::createTerminal(0)),
+               std::runtime_error);
+
+  auto candidate = table.getCandidate(1);
+  EXPECT_EQ(std::vector<size_t>(candidate.begin(), candidate.end()),
+            (std::vector<size_t>{1, 2}));
+  // "a" is followed by what 1 starts with, and "c" by "b" or what 2 starts
+  // with, which is nothing
+  const auto followList = table.getFollowList(3);
+  EXPECT_EQ(followList[0], (std::vector<bool>{false, true, true}));
+  EXPECT_EQ(followList[2], (std::vector<bool>{false, true, false}));
+}
@@ -0,0 +1,206 @@
+#include "Lexer.parser.hpp"
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "FirstByteSet.hpp"
+#include "LexerDFABuilder.hpp"
+#include "PerfectHashBuilder.hpp"
+
+using namespace GeneratedParser;
+
+namespace {
+// A lexer over a few terminals, built the same way as by the generator.
+// Strings must outlive the lexer.
+class TestLexer : public Lexer {
+ protected:
+  ParserGenerator::LexerDFABuilder dfaBuilder;
+  ParserGenerator::PerfectHashBuilder hashBuilder;
+
+ public:
+  explicit TestLexer(std::string_view source) : Lexer(source) {}
+
+  void addString(std::string_view str) {
+    const size_t terminal = matcherList.size();
+    matcherList.push_back(std::make_unique<StringMatcher>(str));
+    firstByteSetList.push_back(ParserGenerator::createFirstByteSet(str));
+    dfaBuilder.addString(terminal, str);
+    hashBuilder.add(str, terminal);
+  }
+
+  // Left to the matcher if it can not be in the DFA
+  void addRegex(std::string_view regex) {
+    const size_t terminal = matcherList.size();
+    matcherList.push_back(std::make_unique<RegexMatcher>(regex));
+    firstByteSetList.push_back(
+        ParserGenerator::createFirstByteSet(Regex(regex)));
+    (void)dfaBuilder.addRegex(terminal, regex);
+  }
+
+  void addRegexExclude(std::string_view regex,
+                       const std::vector<size_t>& excludeList) {
+    const size_t terminal = matcherList.size();
+    matcherList.push_back(
+        std::make_unique<RegexExcludeMatcher>(regex, excludeList));
+    firstByteSetList.push_back(
+        ParserGenerator::createFirstByteSet(Regex(regex)));
+    dfaBuilder.addRegexExclude(terminal, regex,
+                               {excludeList.begin(), excludeList.end()});
+  }
+
+  // A terminal with a DFA of its own, which accepts it as terminal 0
+  void addDFA(LexerDFA dfa) {
+    matcherList.push_back(std::make_unique<DFAMatcher>(std::move(dfa)));
+    firstByteSetList.emplace_back();
+  }
+
+  // Throw at any "#", e.g. to fail inside a worker of tokenize()
+  struct ThrowMatcher : public Matcher {
+    [[nodiscard]] bool match(Stream& stream, MatchState&) override {
+      throw std::runtime_error(std::to_string(stream.tellg()));
+    }
+  };
+
+  void addThrow() {
+    matcherList.push_back(std::make_unique<ThrowMatcher>());
+    ByteSet firstByteSet;
+    firstByteSet.set('#');
+    firstByteSetList.push_back(firstByteSet);
+  }
+
+  void build() {
+    dfa = dfaBuilder.build();
+    stringHash = hashBuilder.build();
+    buildRankList();
+    setStepBudget(DEFAULT_STEP_BUDGET);
+  }
+
+  // Read the next token, given the expected terminals
+  const Token& read(const std::vector<size_t>& expectedList) {
+    readNextTokenExpect(createCandidateSet(expectedList));
+    return getCurrentToken();
+  }
+
+  // Every terminal can follow any other
+  [[nodiscard]] TokenizeTable createTokenizeTable() const {
+    std::vector<size_t> expectedList(matcherList.size());
+    std::iota(expectedList.begin(), expectedList.end(), 0);
+    return {{createCandidateSet(expectedList)},
+            0,
+            0,
+            std::vector<size_t>(matcherList.size())};
+  }
+};
+
+// 0 = /[$_A-z]+/ without "if", which is the word of the DFA
+void addIdentifier(TestLexer& lexer) {
+  lexer.addRegexExclude("/[$_A-z]+/", {1});
+  lexer.addString("if");
+}
+}  // namespace
+
+// "[" and "]" are accepted by the word as well, but they are not keywords
+TEST(Lexer, WordOverlapsString) {
+  TestLexer lexer("[a ] if iff");
+  addIdentifier(lexer);
+  lexer.addString("[");
+  lexer.addString("]");
+  lexer.build();
+  EXPECT_EQ(lexer.read({2}).type, 2);
+  const Token& identifier = lexer.read({0});
+  EXPECT_EQ(identifier.type, 0);
+  EXPECT_EQ(lexer.getText(identifier.span), "a");
+  EXPECT_EQ(lexer.read({3}).type, 3);
+  EXPECT_EQ(lexer.read({0, 1}).type, 1);
+  EXPECT_EQ(lexer.read({0, 1}).type, 0);
+  EXPECT_EQ(lexer.read({}).type, Eof);
+}
+
+TEST(Lexer, ParallelThrow) {
+  std::string source;
+  while (source.size() < 4096) source += "if a ";
+  const size_t first = source.size() * 3 / 4;
+  source[first] = '#';
+  source[source.size() - 2] = '#';
+  TestLexer lexer(source);
+  addIdentifier(lexer);
+  lexer.addThrow();
+  lexer.build();
+  // The first "#" is in the last but one chunk, and only the earliest error
+  // is thrown
+  try {
+    (void)lexer.tokenize(lexer.createTokenizeTable(), 8, 256);
+    FAIL() << "Expecting an error from a worker";
+  } catch (const std::runtime_error& error) {
+    EXPECT_EQ(error.what(), std::to_string(first));
+  }
+}
+
+TEST(Lexer, StepBudget) {
+  const std::string source = "\"a\"\n  \"" + std::string(1000, 'a');
+  TestLexer lexer(source);
+  addIdentifier(lexer);
+  // Not greedy, so it is left to the matcher
+  lexer.addRegex(R"(/"[^"]*"/U)");
+  lexer.build();
+  lexer.setStepBudget(100);
+  EXPECT_EQ(lexer.read({2}).type, 2);
+  // The unterminated string fails at its start, instead of a stall
+  try {
+    lexer.read({2});
+    FAIL() << "Expecting a syntax error";
+  } catch (const SyntaxError& error) {
+    EXPECT_EQ(error.offset, 6);
+    EXPECT_STREQ(error.what(), "Regex step budget exceeded at 2:3");
+  }
+
+  // Same on a worker of tokenize()
+  std::string longSource;
+  while (longSource.size() < 4096) longSource += "\"a\" ";
+  longSource += "\"" + std::string(1000, 'a');
+  TestLexer parallel(longSource);
+  addIdentifier(parallel);
+  parallel.addRegex(R"(/"[^"]*"/U)");
+  parallel.build();
+  parallel.setStepBudget(100);
+  EXPECT_THROW((void)parallel.tokenize(parallel.createTokenizeTable(), 8, 256),
+               SyntaxError);
+}
+
+namespace {
+// Scan everything, which only tells whether it is called
+LexerDFA::StateType scanAll(LexerDFA::StateType, const char*, size_t size,
+                            size_t* length, size_t* acceptedLength) {
+  *length = size;
+  if (acceptedLength != nullptr) *acceptedLength = size;
+  return 1;
+}
+}  // namespace
+
+TEST(Lexer, EmittedScanFingerprint) {
+  auto buildDFA = [](std::string_view regex) {
+    ParserGenerator::LexerDFABuilder builder(false);
+    EXPECT_TRUE(builder.addRegex(0, regex));
+    return builder.build();
+  };
+  const LexerDFA dfa = buildDFA("/[a-z]+/");
+  // Same number of states, but other transitions
+  const LexerDFA stale = buildDFA("/[0-9]+/");
+  ASSERT_EQ(dfa.getStateCount(), stale.getStateCount());
+  const uint64_t fingerprint = dfa.getFingerprint(dfa.createAcceptedList(0));
+  EXPECT_NE(stale.getFingerprint(stale.createAcceptedList(0)), fingerprint);
+
+  TestLexer lexer("abc");
+  lexer.addDFA(dfa);
+  const LexerDFA::EmittedScan staleList[] = {
+      {0, stale.getFingerprint(stale.createAcceptedList(0)), scanAll}};
+  EXPECT_EQ(lexer.setEmittedScans(staleList), 0);
+  const LexerDFA::EmittedScan emittedScanList[] = {{0, fingerprint, scanAll}};
+  EXPECT_EQ(lexer.setEmittedScans(emittedScanList), 1);
+}
@@ -0,0 +1,68 @@
+#include "LexerDFABuilder.hpp"
+
+#include <gtest/gtest.h>
+
+#include <string_view>
+
+using namespace ParserGenerator;
+using LexerDFA = GeneratedParser::LexerDFA;
+
+// Return the terminals accepted after consuming the whole string
+std::vector<uint32_t> acceptAll(const LexerDFA& dfa, std::string_view str) {
+  LexerDFA::StateType state = LexerDFA::START;
+  for (const char& ch : str) {
+    state = dfa.next(state, ch);
+    if (state == LexerDFA::DEAD) return {};
+  }
+  auto acceptList = dfa.getAcceptList(state);
+  return {acceptList.begin(), acceptList.end()};
+}
+
+TEST(LexerDFABuilder, Longest) {
+  LexerDFABuilder builder;
+  builder.addString(0, "=");
+  builder.addString(1, "==");
+  EXPECT_TRUE(builder.addRegex(2, R"(/\d+/)"));
+  const LexerDFA dfa = builder.build();
+  EXPECT_EQ(acceptAll(dfa, "="), std::vector<uint32_t>{0});
+  EXPECT_EQ(acceptAll(dfa, "=="), std::vector<uint32_t>{1});
+  EXPECT_EQ(acceptAll(dfa, "123"), std::vector<uint32_t>{2});
+  EXPECT_TRUE(acceptAll(dfa, "===").empty());
+}
+
+TEST(LexerDFABuilder, Exclude) {
+  LexerDFABuilder builder;
+  EXPECT_TRUE(builder.addRegexExclude(0, "/[a-z]+/", {1}));
+  EXPECT_TRUE(builder.addRegex(1, "/if/"));
+  EXPECT_FALSE(builder.addRegex(2, R"(/a(?!b)/)"));
+  const LexerDFA dfa = builder.build();
+  EXPECT_EQ(acceptAll(dfa, "if"), std::vector<uint32_t>{1});
+  EXPECT_EQ(acceptAll(dfa, "iff"), std::vector<uint32_t>{0});
+  EXPECT_FALSE(dfa.isCovered(2));
+  EXPECT_EQ(dfa.wordTerminal, LexerDFA::NO_WORD);
+}
+
+TEST(LexerDFABuilder, Word) {
+  LexerDFABuilder builder;
+  EXPECT_TRUE(builder.addRegexExclude(0, "/[a-z]+/", {1}));
+  builder.addString(1, "if");
+  builder.addString(2, "=");
+  const LexerDFA dfa = builder.build();
+  EXPECT_EQ(dfa.wordTerminal, 0);
+  EXPECT_TRUE(dfa.isWordExcluded(1));
+  EXPECT_TRUE(dfa.isCovered(1));
+  // The keyword is only told apart by the runtime
+  EXPECT_EQ(acceptAll(dfa, "if"), std::vector<uint32_t>{0});
+  EXPECT_EQ(acceptAll(dfa, "="), std::vector<uint32_t>{2});
+}
+
+TEST(LexerDFABuilder, NoWord) {
+  LexerDFABuilder builder(false);
+  EXPECT_TRUE(builder.addRegexExclude(0, "/[a-z]+/", {1}));
+  builder.addString(1, "if");
+  const LexerDFA dfa = builder.build();
+  EXPECT_EQ(dfa.wordTerminal, LexerDFA::NO_WORD);
+  EXPECT_EQ(acceptAll(dfa, "if"), std::vector<uint32_t>{1});
+  EXPECT_EQ(acceptAll(dfa, "iff"), std::vector<uint32_t>{0});
+  EXPECT_EQ(acceptAll(dfa, "i"), std::vector<uint32_t>{0});
+}
@@ -0,0 +1,49 @@
+#include "LexerEmitter.hpp"
+
+#include <gtest/gtest.h>
+
+#include <sstream>
+#include <string>
+
+#include "LexerDFABuilder.hpp"
+
+using namespace ParserGenerator;
+using LexerDFA = GeneratedParser::LexerDFA;
+
+TEST(LexerEmitter, Emit) {
+  LexerDFABuilder builder(false);
+  EXPECT_TRUE(builder.addRegex(0, "/[a-z]+/"));
+  const LexerDFA dfa = builder.build();
+  LexerEmitter emitter;
+  emitter.add(3, "Word", dfa);
+  emitter.add(5, "", dfa);
+  std::stringstream ss;
+  emitter.emit(ss, "NonTerminal.parser.hpp");
+  const std::string source = ss.str();
+  EXPECT_NE(source.find("#include \"NonTerminal.parser.hpp\""),
+            std::string::npos);
+  EXPECT_NE(source.find("StateType scanWord("), std::string::npos);
+  EXPECT_NE(source.find("StateType scanTerminal5("), std::string::npos);
+  std::stringstream fingerprint;
+  fingerprint << "0x" << std::hex
+              << dfa.getFingerprint(dfa.createAcceptedList(0)) << "ULL";
+  EXPECT_NE(source.find("{Terminal::Word, " + fingerprint.str() +
+                        ", scanWord}"),
+            std::string::npos);
+  EXPECT_NE(source.find("{5, " + fingerprint.str() + ", scanTerminal5}"),
+            std::string::npos);
+  // A letter enters the accepting state, and anything else returns
+  EXPECT_NE(source.find("case 97: case 98:"), std::string::npos);
+  EXPECT_NE(source.find("accepted = ++pos;"), std::string::npos);
+  EXPECT_NE(source.find("    default:\n      state = 1;\n      goto exit;"),
+            std::string::npos);
+  // The accepted length is optional
+  EXPECT_NE(source.find("if (accepted != 0 && acceptedLength != nullptr)"),
+            std::string::npos);
+}
+
+TEST(LexerEmitter, Empty) {
+  std::stringstream ss;
+  LexerEmitter().emit(ss, "NonTerminal.parser.hpp");
+  EXPECT_NE(ss.str().find("return {};"), std::string::npos);
+}
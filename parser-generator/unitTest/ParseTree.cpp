@@ -0,0 +1,53 @@
+#include "ParseTree.parser.hpp"
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+using namespace GeneratedParser;
+using Node = ParseTree::Node;
+
+namespace {
+std::vector<PackedSymbol> getChildSymbols(const ParseTree& tree,
+                                          const Node& node) {
+  std::vector<PackedSymbol> symbols;
+  for (const Node& child : tree.getChildren(node))
+    symbols.push_back(child.symbol);
+  return symbols;
+}
+}  // namespace
+
+// 0 = "a" 1 2, 1 = 3, 2 = "b", where 3 derives nothing
+TEST(ParseTree, RemoveEmpty) {
+  EXPECT_EQ(sizeof(Node), 20);
+  const auto a = PackedSymbol::createTerminal(0);
+  const auto b = PackedSymbol::createTerminal(1);
+  ParseTree tree(PackedSymbol::createNonTerminal(0));
+  const auto nonTerminal2 = PackedSymbol::createNonTerminal(2);
+  const std::vector<PackedSymbol> rootChildren{
+      a, PackedSymbol::createNonTerminal(1), nonTerminal2};
+  const uint32_t first = tree.addChildren(ParseTree::ROOT, rootChildren);
+  tree.setSpan(first, {0, 1});
+  const std::vector<PackedSymbol> emptyChildren{
+      PackedSymbol::createNonTerminal(3)};
+  tree.addChildren(first + 1, emptyChildren);
+  const uint32_t bIndex =
+      tree.addChildren(first + 2, std::vector<PackedSymbol>{b});
+  tree.setSpan(bIndex, {2, 1});
+  EXPECT_EQ(getChildSymbols(tree, tree.getRoot()), rootChildren);
+
+  tree.removeEmpty();
+  const auto children = tree.getChildren(tree.getRoot());
+  ASSERT_EQ(children.size(), 2);
+  EXPECT_EQ(children[0].symbol, a);
+  EXPECT_EQ(children[0].getSpan().offset, 0);
+  EXPECT_EQ(children[1].symbol, nonTerminal2);
+  EXPECT_EQ(getChildSymbols(tree, children[1]), std::vector<PackedSymbol>{b});
+  EXPECT_EQ(tree.getChildren(children[1])[0].getSpan().offset, 2);
+
+  tree.setSourceSize(512);
+  const auto statistics = tree.getStatistics();
+  EXPECT_EQ(statistics.nodeCount, 6);
+  EXPECT_GE(statistics.byteCount, 6 * sizeof(Node));
+  EXPECT_EQ(statistics.getBytesPerSourceKB(), statistics.byteCount * 2.0);
+}
@@ -0,0 +1,23 @@
+#include "PerfectHashBuilder.hpp"
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+using namespace ParserGenerator;
+using PerfectHash = GeneratedParser::PerfectHash;
+
+TEST(PerfectHashBuilder, Find) {
+  const std::vector<std::string> keyList = {
+      "if", "in", "do", "for", "new", "try", "var", "let", "=", "==", "===",
+      "!", "!=", "!==", "import", "export", "instanceof", "typeof"};
+  PerfectHashBuilder builder;
+  for (size_t i = 0; i < keyList.size(); i++) builder.add(keyList[i], i);
+  const PerfectHash perfectHash = builder.build();
+  for (size_t i = 0; i < keyList.size(); i++)
+    EXPECT_EQ(perfectHash.find(keyList[i]), i);
+  EXPECT_EQ(perfectHash.find("iff"), PerfectHash::NOT_FOUND);
+  EXPECT_EQ(perfectHash.find(""), PerfectHash::NOT_FOUND);
+  EXPECT_EQ(PerfectHash().find("if"), PerfectHash::NOT_FOUND);
+}
@@ -0,0 +1,20 @@
+#include "Position.parser.hpp"
+
+#include <gtest/gtest.h>
+
+#include <string>
+
+using namespace GeneratedParser;
+
+TEST(LineIndex, GetPosition) {
+  const std::string source = "a\nbc\n\nd";
+  LineIndex lineIndex;
+  lineIndex.extend(std::string_view(source).substr(0, 3));
+  EXPECT_EQ(lineIndex.getPosition(2).toString(), "2:1");
+  lineIndex.extend(source);
+  EXPECT_EQ(lineIndex.getPosition(0).toString(), "1:1");
+  EXPECT_EQ(lineIndex.getPosition(1).toString(), "1:2");
+  EXPECT_EQ(lineIndex.getPosition(3).toString(), "2:2");
+  EXPECT_EQ(lineIndex.getPosition(5).toString(), "3:1");
+  EXPECT_EQ(lineIndex.getPosition(6).toString(), "4:1");
+}
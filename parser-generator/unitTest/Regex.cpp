@@ -1,5 +1,8 @@
 #include <gtest/gtest.h>
 
+#include <atomic>
+#include <thread>
+
 #include "Regex.parser.hpp"
 
 using namespace GeneratedParser;
@@ -8,3 +11,221 @@ TEST(Regex, String) {
   Regex regex(R"(/"([^\\]|(\\.))*"/)");
   EXPECT_TRUE(regex.match(R"("a\"b\c")"));
 }
+
+TEST(Regex, EscapeInCharSet) {
+  EXPECT_FALSE(Regex(R"(/[\\]/)").match("a"));
+  EXPECT_TRUE(Regex(R"(/[\\]/)").match("\\"));
+  EXPECT_TRUE(Regex(R"(/[\n]/)").match("\n"));
+  EXPECT_TRUE(Regex(R"(/[\d]/)").match("5"));
+  Regex notNewline(R"(/[^\n]*a/)");
+  EXPECT_TRUE(notNewline.match("bba"));
+  EXPECT_FALSE(notNewline.match("b\na"));
+}
+
+namespace {
+// @return {int}  : End of the match, or -1
+int matchEnd(const Regex& regex, std::string_view str) {
+  Utility::ChunkedInputStream stream(str);
+  if (!regex.match(stream)) return -1;
+  return static_cast<int>(stream.tellg());
+}
+}  // namespace
+
+TEST(Regex, ByteSet) {
+  // Bytes above ASCII are in a negated set, and they are consumed
+  Regex notBackslash(R"(/[^\\]+/)");
+  EXPECT_TRUE(notBackslash.match("\x80"));
+  EXPECT_EQ(matchEnd(notBackslash, "a\x80\xc3\xa9\n\\"), 5);
+  EXPECT_FALSE(notBackslash.match("\\"));
+  // A byte above ASCII which the set excludes
+  Regex notLead("/[^\xc3]+/");
+  EXPECT_FALSE(notLead.match("\xc3\xa9"));
+  EXPECT_EQ(matchEnd(notLead, "a\xa9\xc3\xa9"), 2);
+  EXPECT_FALSE(Regex("/[a-z]/").match("\x80"));
+  Regex notDigit(R"(/[^a\d]/)");
+  EXPECT_TRUE(notDigit.match("b"));
+  EXPECT_FALSE(notDigit.match("5"));
+  EXPECT_FALSE(notDigit.match("a"));
+  // A single-char condition is only a bit probe in the NFA
+  Regex range(R"(/[b-d]e/)");
+  const auto edgeList =
+      range.getFlatNFA().getEdgeList(Regex::FlatNFA::START_STATE);
+  ASSERT_EQ(edgeList.size(), 1);
+  EXPECT_TRUE(edgeList.front().isSingleChar());
+  EXPECT_EQ(edgeList.front().byteSet.count(), 3);
+}
+
+TEST(Regex, Property) {
+  Regex identifier(R"(/[$_\p{ID_Start}][$\p{ID_Continue}]*/)");
+  EXPECT_TRUE(identifier.match("a1"));
+  EXPECT_TRUE(identifier.match("$h\xc3\xa9llo"));
+  EXPECT_TRUE(identifier.match("\xe4\xb8\xad\xe6\x96\x87"));
+  EXPECT_FALSE(identifier.match("1a"));
+  // Combining acute accent, which can not start an identifier
+  EXPECT_FALSE(identifier.match("\xcc\x81"));
+  EXPECT_TRUE(identifier.match("a\xcc\x81"));
+  EXPECT_TRUE(Regex(R"(/\p{ID_Start}+/)").match("\xf0\x9d\x91\xa5x"));
+  EXPECT_TRUE(Regex(R"(/[^\p{ID_Start}]/)").match("\xc2\xa0"));
+  EXPECT_FALSE(Regex(R"(/[^\p{ID_Start}]/)").match("\xc3\xa9"));
+  EXPECT_THROW(Regex(R"(/\p{Emoji}/)"), std::runtime_error);
+}
+
+TEST(Regex, LazyDFA) {
+  const std::vector<std::string> regexList{
+      R"(/a*b/)", R"(/(ab|a)*/)", R"(/[a-c]+d?/U)", R"(/x(y|z)*y/)",
+      R"(/[$_\p{ID_Start}][$\p{ID_Continue}]*/)"};
+  const std::vector<std::string> inputList{
+      "",   "b",    "aab",  "abab", "aba",      "acd",
+      "cb", "xyzy", "xyz",  "xyy",  "a\xcc\x81", "\xc3\xa9x"};
+  for (const auto& regexStr : regexList) {
+    Regex dfa(regexStr);
+    // Without any cache, everything is left to the NFA
+    Regex nfa(regexStr, 0);
+    Regex small(regexStr, 200);
+    // Only a few states fit, so the cache is flushed while matching
+    Regex flushed(regexStr, 8 << 10);
+    for (const auto& input : inputList) {
+      SCOPED_TRACE(regexStr + " " + input);
+      // Twice, so the cached states are used as well
+      for (int i = 0; i < 2; i++) {
+        EXPECT_EQ(matchEnd(dfa, input), matchEnd(nfa, input));
+        EXPECT_EQ(matchEnd(small, input), matchEnd(nfa, input));
+        EXPECT_EQ(matchEnd(flushed, input), matchEnd(nfa, input));
+      }
+    }
+  }
+}
+
+TEST(Regex, FlatNFA) {
+  Regex regex(R"(/((ab)|a)*c?/)");
+  const auto& nfa = regex.getFlatNFA();
+  EXPECT_EQ(nfa.size(), regex.stateList.size());
+  // The start state reaches a final state by epsilon transitions only
+  EXPECT_TRUE(nfa.isMatched(Regex::FlatNFA::START_STATE));
+  const std::vector<std::pair<std::string_view, size_t>> endList{
+      {"", 0}, {"abac", 4}, {"ac", 2}, {"cc", 1}, {"aab", 3}};
+  for (const auto& [input, end] : endList) {
+    Regex::StringController controller(input);
+    EXPECT_TRUE(nfa.match(controller, true));
+    EXPECT_EQ(controller.record(), end);
+  }
+  // An epsilon cycle is only followed once
+  EXPECT_TRUE(Regex(R"(/(a|b*)*c/)").match("abbc"));
+}
+
+TEST(Regex, Find) {
+  Regex commentEnd(R"(/\*\//)");
+  const std::string_view comment = "/* a * b /* c */ d */";
+  auto found = commentEnd.find(comment);
+  ASSERT_TRUE(found);
+  EXPECT_EQ(found->start, 14);
+  EXPECT_EQ(found->end, 16);
+  found = commentEnd.find(comment, found->end);
+  ASSERT_TRUE(found);
+  EXPECT_EQ(found->start, 19);
+  EXPECT_FALSE(commentEnd.find("/* a *"));
+  // Starts with either byte
+  Regex quote(R"(/["'][a-z]*/)");
+  found = quote.find("x = 'ab' + 1");
+  ASSERT_TRUE(found);
+  EXPECT_EQ(found->start, 4);
+  EXPECT_EQ(found->end, 7);
+  // Every position matches the empty string
+  found = Regex(R"(/a*/)").find("bba", 1);
+  ASSERT_TRUE(found);
+  EXPECT_EQ(found->start, 1);
+  EXPECT_EQ(found->end, 1);
+  found = Regex(R"(/[\p{ID_Start}]+/)").find("1 + \xc3\xa9t\xc3\xa9");
+  ASSERT_TRUE(found);
+  EXPECT_EQ(found->start, 4);
+  EXPECT_EQ(found->end, 9);
+}
+
+TEST(Regex, Lookahead) {
+  Regex notB(R"(/a(?!b)/)");
+  EXPECT_TRUE(notB.match("ac"));
+  EXPECT_FALSE(notB.match("ab"));
+  Regex isB(R"(/a(?=b)/)");
+  EXPECT_TRUE(isB.match("ab"));
+  EXPECT_FALSE(isB.match("ac"));
+  // MultiLineCommentChars of js.ebnf stops before the end of the comment
+  Regex commentChars(R"(/([^*]|(\*(?!\/)))*/)");
+  EXPECT_EQ(matchEnd(commentChars, " a * b */"), 7);
+  EXPECT_EQ(matchEnd(commentChars, " a **/"), 4);
+  EXPECT_TRUE(Regex(R"(/\/\*([^*]|(\*(?!\/)))*\*\//)").match("/* a * b */"));
+  // A lookahead reads no char, even at the end of the input
+  EXPECT_TRUE(Regex(R"(/a(?!b)c/)").match("ac"));
+  EXPECT_FALSE(Regex(R"(/a(?!c)c/)").match("ac"));
+  EXPECT_EQ(matchEnd(notB, "a"), 1);
+  EXPECT_EQ(matchEnd(isB, "abc"), 1);
+  // Inside a loop, and nested
+  EXPECT_EQ(matchEnd(Regex(R"(/((?=a)[a-z])*/)"), "aab"), 2);
+  Regex nested(R"(/a(?=b(?!c))/)");
+  EXPECT_TRUE(nested.match("abd"));
+  EXPECT_FALSE(nested.match("abc"));
+  for (const auto& regexStr : {R"(/a(?!b)c/)", R"(/((?=a)[a-z])*/)"}) {
+    Regex dfa(regexStr);
+    Regex nfa(regexStr, 0);
+    for (const std::string_view input : {"ac", "abc", "aab", "aac"})
+      EXPECT_EQ(matchEnd(dfa, input), matchEnd(nfa, input));
+  }
+}
+
+TEST(Regex, StepBudget) {
+  Regex regex(R"(/"[^"]*"/)");
+  const std::string unterminated = "\"" + std::string(1000, 'a');
+  EXPECT_FALSE(regex.match(unterminated));
+  regex.setStepBudget(100);
+  EXPECT_TRUE(regex.match("\"abc\""));
+  EXPECT_THROW((void)regex.match(unterminated), Regex::StepBudgetException);
+  // A step is a char, whether the lazy DFA has cached it or not
+  for (const size_t cacheSize :
+       {Regex::DEFAULT_CACHE_SIZE, size_t{200}, size_t{0}}) {
+    SCOPED_TRACE(cacheSize);
+    Regex cached(R"(/"[^"]*"/)", cacheSize);
+    for (int i = 0; i < 2; i++) {
+      cached.setStepBudget(unterminated.size());
+      EXPECT_FALSE(cached.match(unterminated));
+      cached.setStepBudget(unterminated.size() - 1);
+      EXPECT_THROW((void)cached.match(unterminated),
+                   Regex::StepBudgetException);
+    }
+  }
+  // Every try is in the budget, but not all of them
+  Regex unclosed(R"(/"a*b/)");
+  std::string quotes;
+  while (quotes.size() < 200) quotes += "\"aa";
+  EXPECT_FALSE(unclosed.find(quotes));
+  unclosed.setStepBudget(100);
+  EXPECT_THROW((void)unclosed.find(quotes), Regex::StepBudgetException);
+  // The steps of lookaheads count as well, but each pair of a state and a
+  // position is only searched once, so they stay linear
+  const std::string input = std::string(2000, 'a') + "b";
+  for (const auto& regexStr :
+       {R"(/((?=a*b)a)*/)", R"(/((?=((?=a*b)a)*b)a)*/)"}) {
+    SCOPED_TRACE(regexStr);
+    Regex lookahead(regexStr);
+    lookahead.setStepBudget(20 * input.size());
+    EXPECT_EQ(matchEnd(lookahead, input), input.size() - 1);
+    lookahead.setStepBudget(input.size());
+    EXPECT_THROW((void)lookahead.match(input), Regex::StepBudgetException);
+  }
+}
+
+TEST(Regex, LazyDFAThread) {
+  Regex regex(R"(/[a-z]+[0-9]*/)");
+  // Flushed by one thread while the others read it
+  Regex flushed(R"(/[a-z]+[0-9]*/)", 6 << 10);
+  std::vector<std::thread> threadList;
+  std::atomic<int> failedCount = 0;
+  for (int i = 0; i < 4; i++)
+    threadList.emplace_back([&regex, &flushed, &failedCount]() {
+      for (int j = 0; j < 1000; j++)
+        for (const Regex* current : {&regex, &flushed})
+          if (!current->match("abc" + std::to_string(j)) ||
+              current->match("1a") || matchEnd(*current, "ab1.") != 3)
+            failedCount++;
+    });
+  for (auto& thread : threadList) thread.join();
+  EXPECT_EQ(failedCount, 0);
+}
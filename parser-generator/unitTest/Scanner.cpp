@@ -0,0 +1,39 @@
+#include "Scanner.parser.hpp"
+
+#include <gtest/gtest.h>
+
+#include <string>
+
+using namespace GeneratedParser;
+
+TEST(Scanner, FindNotSpace) {
+  std::string input(100, ' ');
+  input[37] = '\t';
+  input[70] = '\n';
+  EXPECT_EQ(Scanner::findNotSpace(input), input.size());
+  input[81] = 'a';
+  EXPECT_EQ(Scanner::findNotSpace(input), 81);
+  EXPECT_EQ(Scanner::findNotSpace(" \x0b\x0c\r\xa0"), 4);
+}
+
+TEST(Scanner, FindEitherByte) {
+  std::string input(100, 'a');
+  EXPECT_EQ(Scanner::findEitherByte(input, '"', '\\'), input.size());
+  input[95] = '\\';
+  input[60] = '"';
+  EXPECT_EQ(Scanner::findEitherByte(input, '"', '\\'), 60);
+  EXPECT_EQ(Scanner::findEitherByte(input.substr(61), '"', '\\'), 34);
+  EXPECT_EQ(Scanner::findByte(input, '\\'), 95);
+}
+
+TEST(Scanner, FindInvalidUtf8) {
+  std::string input(100, 'a');
+  EXPECT_EQ(Scanner::findNotAscii(input), input.size());
+  input.replace(40, 3, "\xe4\xb8\xad");
+  EXPECT_EQ(Scanner::findNotAscii(input), 40);
+  EXPECT_EQ(Scanner::findInvalidUtf8(input), input.size());
+  input[90] = '\xc3';
+  EXPECT_EQ(Scanner::findInvalidUtf8(input), 90);
+  // Cut by the end
+  EXPECT_EQ(Scanner::findInvalidUtf8(input.substr(0, 42)), 40);
+}
@@ -0,0 +1,40 @@
+#include "ScannerShape.hpp"
+
+#include <gtest/gtest.h>
+
+#include "Regex.parser.hpp"
+
+using namespace ParserGenerator;
+
+TEST(ScannerShape, Detect) {
+  auto shape = ScannerShape::detect(R"(/[^\n]*/)");
+  EXPECT_EQ(shape.type, ScannerShape::UntilByte);
+  EXPECT_EQ(shape.first, '\n');
+
+  shape = ScannerShape::detect(R"(/([^*]|(\*(?!\/)))*/)");
+  EXPECT_EQ(shape.type, ScannerShape::UntilSequence);
+  EXPECT_EQ(shape.first, '*');
+  EXPECT_EQ(shape.second, '/');
+
+  shape = ScannerShape::detect(R"(/"([^"\\]|(\\.))*"/)");
+  EXPECT_EQ(shape.type, ScannerShape::Quoted);
+  EXPECT_EQ(shape.first, '"');
+
+  // The body may contain the quote, so it is not a quoted string
+  EXPECT_EQ(ScannerShape::detect(R"(/"([^\\]|(\\.))*"/)").type,
+            ScannerShape::None);
+  EXPECT_EQ(ScannerShape::detect(R"(/\d+/)").type, ScannerShape::None);
+
+  shape = ScannerShape::detect(R"(/[$_\p{ID_Start}][\$\p{ID_Continue}]*/)");
+  EXPECT_EQ(shape.type, ScannerShape::Identifier);
+  EXPECT_EQ(shape.extraStart, "$_");
+  EXPECT_EQ(shape.extraPart, "$");
+  const GeneratedParser::Regex asciiRegex(shape.createAsciiRegex());
+  EXPECT_TRUE(asciiRegex.match("$_a1"));
+  EXPECT_TRUE(asciiRegex.match("_"));
+  EXPECT_FALSE(asciiRegex.match("1a"));
+  EXPECT_FALSE(asciiRegex.match("\xc3\xa9"));
+  EXPECT_EQ(ScannerShape::detect(R"(/[a-z\p{ID_Start}][\p{ID_Continue}]*/)")
+                .type,
+            ScannerShape::None);
+}
@@ -0,0 +1,38 @@
+#include "Token.parser.hpp"
+
+#include <gtest/gtest.h>
+
+using namespace GeneratedParser;
+
+TEST(TokenBuffer, FindAndAppend) {
+  TokenBuffer first;
+  first.push(1, {0, 2});
+  TokenBuffer second;
+  second.push(2, {3, 1});
+  second.push(3, {5, 4});
+  EXPECT_EQ(second.find(5), 1);
+  EXPECT_EQ(second.find(4), second.size());
+  first.append(second, second.find(5));
+  ASSERT_EQ(first.size(), 2);
+  EXPECT_EQ(first.getType(1), 3);
+  EXPECT_EQ(first.getSpan(1).offset, 5);
+  EXPECT_EQ(first.getSpan(1).length, 4);
+}
+
+TEST(TokenBuffer, Replace) {
+  TokenBuffer tokenBuffer;
+  tokenBuffer.push(1, {0, 2}, 1);
+  tokenBuffer.push(2, {3, 1}, 1);
+  tokenBuffer.push(3, {5, 4}, 1);
+  EXPECT_EQ(tokenBuffer.findLookingAt(2), 0);
+  EXPECT_EQ(tokenBuffer.findLookingAt(3), 1);
+  EXPECT_EQ(tokenBuffer.findLookingAt(10), tokenBuffer.size());
+
+  TokenBuffer replacement;
+  replacement.push(4, {3, 3}, 1);
+  tokenBuffer.replace(1, 1, replacement, 0, 1, 2);
+  ASSERT_EQ(tokenBuffer.size(), 3);
+  EXPECT_EQ(tokenBuffer.getType(1), 4);
+  EXPECT_EQ(tokenBuffer.getSpan(1).length, 3);
+  EXPECT_EQ(tokenBuffer.getSpan(2).offset, 7);
+}
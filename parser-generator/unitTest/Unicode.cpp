@@ -0,0 +1,57 @@
+#include "Unicode.parser.hpp"
+
+#include <gtest/gtest.h>
+
+#include <string_view>
+
+using namespace GeneratedParser;
+
+namespace {
+char32_t decode(std::string_view str, size_t& length) {
+  size_t i = 0;
+  return Unicode::decode(
+      [&]() -> int {
+        if (i >= str.size()) return EOF;
+        return static_cast<unsigned char>(str[i++]);
+      },
+      length);
+}
+}  // namespace
+
+TEST(Unicode, HasProperty) {
+  using Unicode::IdContinue;
+  using Unicode::IdStart;
+  EXPECT_TRUE(Unicode::hasProperty('a', IdStart));
+  EXPECT_FALSE(Unicode::hasProperty('1', IdStart));
+  EXPECT_TRUE(Unicode::hasProperty('1', IdContinue));
+  EXPECT_TRUE(Unicode::hasProperty('_', IdContinue));
+  EXPECT_FALSE(Unicode::hasProperty('$', IdContinue));
+  // é, 中 and 𝑥
+  EXPECT_TRUE(Unicode::hasProperty(0xE9, IdStart));
+  EXPECT_TRUE(Unicode::hasProperty(0x4E2D, IdStart));
+  EXPECT_TRUE(Unicode::hasProperty(0x1D465, IdStart));
+  // Combining acute accent
+  EXPECT_FALSE(Unicode::hasProperty(0x301, IdStart));
+  EXPECT_TRUE(Unicode::hasProperty(0x301, IdContinue));
+  // No-break space, and a letter which is pattern syntax
+  EXPECT_FALSE(Unicode::hasProperty(0xA0, IdContinue));
+  EXPECT_FALSE(Unicode::hasProperty(0x2E2F, IdContinue));
+  EXPECT_FALSE(Unicode::hasProperty(0x10FFFF, IdContinue));
+}
+
+TEST(Unicode, Decode) {
+  size_t length = 0;
+  EXPECT_EQ(decode("a", length), 'a');
+  EXPECT_EQ(length, 1);
+  EXPECT_EQ(decode("\xc3\xa9", length), 0xE9);
+  EXPECT_EQ(length, 2);
+  EXPECT_EQ(decode("\xe4\xb8\xad", length), 0x4E2D);
+  EXPECT_EQ(length, 3);
+  EXPECT_EQ(decode("\xf0\x9d\x91\xa5", length), 0x1D465);
+  EXPECT_EQ(length, 4);
+  // Overlong, surrogate, above U+10FFFF, cut and a lone continuation
+  for (std::string_view invalid :
+       {"\xc0\x80", "\xe0\x9f\xbf", "\xed\xa0\x80", "\xf4\x90\x80\x80",
+        "\xe4\xb8", "\x80", "\xff"})
+    EXPECT_EQ(decode(invalid, length), Unicode::INVALID) << invalid.size();
+}
@@ -0,0 +1,81 @@
+#include "Utility.parser.hpp"
+
+#include <gtest/gtest.h>
+
+#include <sstream>
+#include <string>
+
+#include "Position.parser.hpp"
+
+using namespace GeneratedParser::Utility;
+
+TEST(ChunkedInputStream, AcrossBlock) {
+  std::string input(ChunkedInputStream::BLOCK_SIZE * 2 + 7, 'a');
+  input.replace(ChunkedInputStream::BLOCK_SIZE - 2, 4, "bcde");
+  std::stringstream stdStream(input);
+  ChunkedInputStream stream(stdStream);
+  for (size_t i = 0; i < ChunkedInputStream::BLOCK_SIZE - 2; i++)
+    EXPECT_EQ(stream.get(), 'a');
+  size_t pos = stream.tellg();
+  EXPECT_EQ(stream.get(), 'b');
+  EXPECT_EQ(stream.get(), 'c');
+  EXPECT_EQ(stream.get(), 'd');
+  EXPECT_EQ(stream.substr(pos, 3), "bcd");
+  stream.seekg(pos);
+  EXPECT_EQ(stream.peek(), 'b');
+  while (stream.get() != EOF) continue;
+  EXPECT_EQ(stream.tellg(), input.size() + 1);
+}
+
+TEST(ChunkedInputStream, Contiguous) {
+  std::string_view input = "abc";
+  ChunkedInputStream stream(input);
+  EXPECT_EQ(stream.get(), 'a');
+  stream.read();
+  EXPECT_EQ(stream.substr(1, 1).data(), input.data() + 1);
+  EXPECT_EQ(stream.get(), 'c');
+  EXPECT_EQ(stream.peek(), EOF);
+}
+
+TEST(ChunkedInputStream, Substr) {
+  std::string input(ChunkedInputStream::BLOCK_SIZE + 3, 'a');
+  input.replace(ChunkedInputStream::BLOCK_SIZE - 1, 3, "bcd");
+  std::stringstream stdStream(input);
+  ChunkedInputStream stream(stdStream);
+  while (stream.get() != EOF) continue;
+  EXPECT_EQ(stream.substr(ChunkedInputStream::BLOCK_SIZE - 1, 3), "bcd");
+}
+
+TEST(ChunkedInputStream, CheckUtf8) {
+  // A code point is cut by the end of the first block
+  std::string input(ChunkedInputStream::BLOCK_SIZE + 2, 'a');
+  input.replace(ChunkedInputStream::BLOCK_SIZE - 1, 3, "\xe4\xb8\xad");
+  std::stringstream stdStream(input);
+  ChunkedInputStream stream(stdStream);
+  stream.checkUtf8();
+  while (stream.get() != EOF) continue;
+  EXPECT_EQ(stream.tellg(), input.size() + 1);
+
+  input.back() = '\xc3';
+  std::stringstream cutStream(input);
+  ChunkedInputStream cut(cutStream);
+  cut.checkUtf8();
+  try {
+    while (cut.get() != EOF) continue;
+    FAIL() << "Expecting a syntax error";
+  } catch (const GeneratedParser::SyntaxError& error) {
+    // At the lead byte of the broken sequence
+    EXPECT_EQ(error.offset, ChunkedInputStream::BLOCK_SIZE - 1);
+    EXPECT_EQ(error.position.line, 1);
+    EXPECT_EQ(error.position.column, ChunkedInputStream::BLOCK_SIZE);
+  }
+
+  try {
+    ChunkedInputStream(std::string_view("a\nb\x80")).checkUtf8();
+    FAIL() << "Expecting a syntax error";
+  } catch (const GeneratedParser::SyntaxError& error) {
+    EXPECT_EQ(error.offset, 3);
+    EXPECT_EQ(error.position.toString(), "2:2");
+    EXPECT_STREQ(error.what(), "Invalid UTF-8 at 2:2");
+  }
+}
@@ -3,10 +3,15 @@
 #include <memory>
 #include <queue>
 #include <stdexcept>
+#include <string>
+#include <string_view>
 
 #include "Exception.hpp"
 #include "Expression.hpp"
+#include "LexerDFA.parser.hpp"
+#include "LexerJit.hpp"
 #include "NonTerminal.parser.hpp"
+#include "ParseTree.parser.hpp"
 #include "Serializer.parser.hpp"
 #include "Utility.hpp"
 
@@ -16,26 +21,44 @@ using namespace Serializer;
 
 extern const BinaryIType js_ebnf[];
 
-JsParser::JsParser(std::unique_ptr<Lexer> lexer)
+JsParser::JsParser(std::unique_ptr<Lexer> lexer, LexerDFAMode lexerDFAMode)
     : Parser(std::move(lexer),
-             BinaryDeserializer::create<ArrayStream>(js_ebnf)){};
+             BinaryDeserializer::create<ArrayStream>(js_ebnf)) {
+  switch (lexerDFAMode) {
+    case LexerDFAMode::Table:
+      break;
+    case LexerDFAMode::Emitted:
+      this->lexer->setEmittedScans(getEmittedScanList());
+      break;
+    case LexerDFAMode::Jit:
+#ifdef JS_COMPILER_LEXER_JIT
+      this->lexer->compileDFAMatchers(
+          [](const LexerDFA& dfa, const std::vector<bool>& acceptedList) {
+            return LexerJit::getInstance().compile(dfa, acceptedList);
+          });
+#endif
+      break;
+  }
+};
 
 std::unique_ptr<JsCompiler::Expression> JsParser::parseExpression() {
-  const auto& root = Parser::parseExpression();
+  // Freed at once when it goes out of scope
+  const ParseTree tree = Parser::parseExpression();
+  using Node = ParseTree::Node;
   std::stack<const Node*> postOrderStack;
-  std::stack<const Node*> traverseStack({&root});
+  std::stack<const Node*> traverseStack({&tree.getRoot()});
   while (!traverseStack.empty()) {
     const Node& node = *traverseStack.top();
     traverseStack.pop();
     if (node.symbol.type == Symbol::End) continue;
-    if (!node.children.empty() || node.symbol.type == Symbol::Terminal)
+    if (node.childCount != 0 || node.symbol.type == Symbol::Terminal)
       postOrderStack.push(&node);
-    for (const Node& child : node.children) {
+    for (const Node& child : tree.getChildren(node)) {
       traverseStack.push(&child);
     }
   }
 
-  std::list<std::string> terminalList;
+  std::list<std::string_view> terminalList;
   std::queue<std::unique_ptr<Expression>> expressionQueue;
   while (!postOrderStack.empty()) {
     const Node& node = *postOrderStack.top();
@@ -43,13 +66,13 @@ std::unique_ptr<JsCompiler::Expression> JsParser::parseExpression() {
       case Symbol::End:
         break;
       case Symbol::Terminal:
-        terminalList.push_back(node.value);
+        terminalList.push_back(getText(node));
         break;
       case Symbol::NonTerminal:
         switch (node.symbol.getNonTerminal()) {
           case ModuleSpecifier:
-            expressionQueue.push(
-                std::make_unique<ImportExpression>(terminalList.back()));
+            expressionQueue.push(std::make_unique<ImportExpression>(
+                std::string(terminalList.back())));
             terminalList.clear();
           default:
             break;
@@ -0,0 +1,224 @@
+#include "LexerJit.hpp"
+
+#ifdef JS_COMPILER_LEXER_JIT
+#include <llvm/ExecutionEngine/Orc/LLJIT.h>
+#include <llvm/ExecutionEngine/Orc/ThreadSafeModule.h>
+#include <llvm/IR/IRBuilder.h>
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/IR/Module.h>
+#include <llvm/IR/Verifier.h>
+#include <llvm/Passes/PassBuilder.h>
+#include <llvm/Support/TargetSelect.h>
+
+#include <algorithm>
+#include <array>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+using namespace JsCompiler;
+using namespace llvm;
+
+namespace {
+std::string createKey(const LexerDFA& dfa,
+                      const std::vector<bool>& acceptedList) {
+  std::string key = std::to_string(dfa.byteClassCount) + ":";
+  key.append(reinterpret_cast<const char*>(dfa.byteClassMap.data()),
+             dfa.byteClassMap.size());
+  key.append(reinterpret_cast<const char*>(dfa.transitionTable.data()),
+             dfa.transitionTable.size() * sizeof(LexerDFA::StateType));
+  for (const bool isAccepted : acceptedList) key.push_back(isAccepted);
+  return key;
+}
+
+/*
+ * Same as the table loop of Lexer::DFAMatcher. Every state has a block which
+ * returns at the end of data, and a switch over the byte to the block which
+ * enters the next state. A byte to DEAD returns without consuming it. All
+ * returns go through one exit block, which stores the accepted length.
+ */
+Function* buildScanFunction(Module& module, const std::string& name,
+                            const LexerDFA& dfa,
+                            const std::vector<bool>& acceptedList) {
+  LLVMContext& context = module.getContext();
+  IRBuilder<> builder(context);
+  Type* stateType = builder.getInt32Ty();
+  Type* sizeType = builder.getInt64Ty();
+  auto* functionType = FunctionType::get(
+      stateType,
+      {stateType, builder.getInt8PtrTy(), sizeType, sizeType->getPointerTo(),
+       sizeType->getPointerTo()},
+      false);
+  Function* function =
+      Function::Create(functionType, Function::ExternalLinkage, name, module);
+  auto* argument = function->arg_begin();
+  Value* startState = argument++;
+  Value* data = argument++;
+  Value* size = argument++;
+  Value* length = argument++;
+  Value* acceptedLength = argument;
+
+  const auto stateCount =
+      static_cast<LexerDFA::StateType>(dfa.getStateCount());
+  BasicBlock* entryBlock = BasicBlock::Create(context, "entry", function);
+  std::vector<BasicBlock*> stateBlockList;
+  std::vector<BasicBlock*> enterBlockList;
+  for (LexerDFA::StateType state = 0; state < stateCount; state++) {
+    stateBlockList.push_back(BasicBlock::Create(context, "state", function));
+    enterBlockList.push_back(BasicBlock::Create(context, "enter", function));
+  }
+
+  builder.SetInsertPoint(entryBlock);
+  // Promoted to registers by the optimizer. Entering a state consumes a
+  // byte, so an accepted length of 0 is none.
+  AllocaInst* pos = builder.CreateAlloca(sizeType);
+  AllocaInst* accepted = builder.CreateAlloca(sizeType);
+  AllocaInst* result = builder.CreateAlloca(stateType);
+  builder.CreateStore(builder.getInt64(0), pos);
+  builder.CreateStore(builder.getInt64(0), accepted);
+  BasicBlock* unknownBlock = BasicBlock::Create(context, "unknown", function);
+  SwitchInst* stateSwitch =
+      builder.CreateSwitch(startState, unknownBlock, stateCount);
+  for (LexerDFA::StateType state = 0; state < stateCount; state++)
+    stateSwitch->addCase(builder.getInt32(state), stateBlockList[state]);
+  builder.SetInsertPoint(unknownBlock);
+  builder.CreateStore(builder.getInt64(0), length);
+  builder.CreateRet(startState);
+
+  // acceptedLength may be null, and it is left as is if nothing is accepted
+  BasicBlock* returnBlock = BasicBlock::Create(context, "return", function);
+  BasicBlock* storeBlock = BasicBlock::Create(context, "store", function);
+  BasicBlock* doneBlock = BasicBlock::Create(context, "done", function);
+  builder.SetInsertPoint(returnBlock);
+  builder.CreateStore(builder.CreateLoad(sizeType, pos), length);
+  Value* acceptedPos = builder.CreateLoad(sizeType, accepted);
+  builder.CreateCondBr(
+      builder.CreateAnd(
+          builder.CreateICmpNE(acceptedPos, builder.getInt64(0)),
+          builder.CreateIsNotNull(acceptedLength)),
+      storeBlock, doneBlock);
+  builder.SetInsertPoint(storeBlock);
+  builder.CreateStore(acceptedPos, acceptedLength);
+  builder.CreateBr(doneBlock);
+  builder.SetInsertPoint(doneBlock);
+  builder.CreateRet(builder.CreateLoad(stateType, result));
+
+  for (LexerDFA::StateType state = 0; state < stateCount; state++) {
+    BasicBlock* exitBlock = BasicBlock::Create(context, "exit", function);
+    BasicBlock* readBlock = BasicBlock::Create(context, "read", function);
+    builder.SetInsertPoint(stateBlockList[state]);
+    builder.CreateCondBr(builder.CreateICmpEQ(builder.CreateLoad(sizeType, pos),
+                                              size),
+                         exitBlock, readBlock);
+
+    builder.SetInsertPoint(exitBlock);
+    builder.CreateStore(builder.getInt32(state), result);
+    builder.CreateBr(returnBlock);
+
+    // The most common target is the default of the switch
+    std::array<LexerDFA::StateType, 256> nextList{};
+    std::map<LexerDFA::StateType, size_t> countMap;
+    for (size_t byte = 0; byte < nextList.size(); byte++)
+      countMap[nextList[byte] = dfa.next(state, byte)]++;
+    const LexerDFA::StateType defaultNext =
+        std::max_element(countMap.begin(), countMap.end(),
+                         [](const auto& a, const auto& b) {
+                           return a.second < b.second;
+                         })
+            ->first;
+    auto getTarget = [&](LexerDFA::StateType next) {
+      return next == LexerDFA::DEAD ? exitBlock : enterBlockList[next];
+    };
+
+    builder.SetInsertPoint(readBlock);
+    Value* byte = builder.CreateLoad(
+        builder.getInt8Ty(),
+        builder.CreateGEP(builder.getInt8Ty(), data,
+                          builder.CreateLoad(sizeType, pos)));
+    SwitchInst* byteSwitch = builder.CreateSwitch(
+        byte, getTarget(defaultNext),
+        nextList.size() - countMap.at(defaultNext));
+    for (size_t byteValue = 0; byteValue < nextList.size(); byteValue++)
+      if (nextList[byteValue] != defaultNext)
+        byteSwitch->addCase(builder.getInt8(byteValue),
+                            getTarget(nextList[byteValue]));
+  }
+
+  for (LexerDFA::StateType state = 0; state < stateCount; state++) {
+    builder.SetInsertPoint(enterBlockList[state]);
+    Value* nextPos = builder.CreateAdd(builder.CreateLoad(sizeType, pos),
+                                       builder.getInt64(1));
+    builder.CreateStore(nextPos, pos);
+    if (acceptedList[state]) builder.CreateStore(nextPos, accepted);
+    builder.CreateBr(stateBlockList[state]);
+  }
+  return function;
+}
+
+void optimize(Module& module) {
+  LoopAnalysisManager loopAnalysisManager;
+  FunctionAnalysisManager functionAnalysisManager;
+  CGSCCAnalysisManager cgsccAnalysisManager;
+  ModuleAnalysisManager moduleAnalysisManager;
+  PassBuilder passBuilder;
+  passBuilder.registerModuleAnalyses(moduleAnalysisManager);
+  passBuilder.registerCGSCCAnalyses(cgsccAnalysisManager);
+  passBuilder.registerFunctionAnalyses(functionAnalysisManager);
+  passBuilder.registerLoopAnalyses(loopAnalysisManager);
+  passBuilder.crossRegisterProxies(loopAnalysisManager, functionAnalysisManager,
+                                   cgsccAnalysisManager, moduleAnalysisManager);
+  passBuilder.buildPerModuleDefaultPipeline(OptimizationLevel::O2)
+      .run(module, moduleAnalysisManager);
+}
+}  // namespace
+
+LexerJit::LexerJit() {
+  InitializeNativeTarget();
+  InitializeNativeTargetAsmPrinter();
+  auto created = orc::LLJITBuilder().create();
+  if (created)
+    jit = std::move(*created);
+  else
+    consumeError(created.takeError());
+}
+
+LexerJit::~LexerJit() = default;
+
+LexerJit& LexerJit::getInstance() {
+  static LexerJit instance;
+  return instance;
+}
+
+LexerDFA::ScanFunction LexerJit::compile(
+    const LexerDFA& dfa, const std::vector<bool>& acceptedList) {
+  if (jit == nullptr || dfa.empty()) return nullptr;
+  std::lock_guard lock(mutex);
+  const std::string key = createKey(dfa, acceptedList);
+  if (auto it = functionMap.find(key); it != functionMap.end())
+    return it->second;
+  const std::string name = "scan" + std::to_string(functionMap.size());
+  auto context = std::make_unique<LLVMContext>();
+  auto module = std::make_unique<Module>(name, *context);
+  module->setDataLayout(jit->getDataLayout());
+  module->setTargetTriple(jit->getTargetTriple().str());
+  const Function* function =
+      buildScanFunction(*module, name, dfa, acceptedList);
+  if (verifyFunction(*function, &errs())) return nullptr;
+  optimize(*module);
+  if (auto error = jit->addIRModule(
+          orc::ThreadSafeModule(std::move(module), std::move(context)))) {
+    consumeError(std::move(error));
+    return nullptr;
+  }
+  auto symbol = jit->lookup(name);
+  if (!symbol) {
+    consumeError(symbol.takeError());
+    return nullptr;
+  }
+  auto scan = reinterpret_cast<LexerDFA::ScanFunction>(symbol->getAddress());
+  functionMap.emplace(key, scan);
+  return scan;
+}
+#endif
@@ -1,11 +1,22 @@
+#include <memory>
+#include <optional>
+
 #include "JsIRBuilder.hpp"
 #include "JsParser.hpp"
+#include "MappedFile.hpp"
 
 using namespace JsCompiler;
 
-int main(int /*argc*/, const char** /*argv*/) {
-  JsIRBuilder builder(
-      JsParser::create((GeneratedParser::Lexer::create(std::cin))));
+int main(int argc, const char** argv) {
+  // Map the source file if given, otherwise read from stdin
+  std::optional<MappedFile> sourceFile;
+  std::unique_ptr<GeneratedParser::Lexer> lexer;
+  if (argc > 1) {
+    sourceFile.emplace(argv[1]);
+    lexer = GeneratedParser::Lexer::create(sourceFile->view());
+  } else
+    lexer = GeneratedParser::Lexer::create(std::cin);
+  JsIRBuilder builder(JsParser::create(std::move(lexer)));
   builder.build();
   return 0;
 }
@@ -0,0 +1,44 @@
+#include "MappedFile.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <system_error>
+
+using namespace JsCompiler;
+
+MappedFile::MappedFile(const std::string& fileName) {
+  int fd = open(fileName.c_str(), O_RDONLY);
+  if (fd == -1)
+    throw std::system_error(errno, std::generic_category(),
+                            "Cannot open " + fileName);
+  struct stat fileStat {};
+  if (fstat(fd, &fileStat) == -1) {
+    int error = errno;
+    close(fd);
+    throw std::system_error(error, std::generic_category(),
+                            "Cannot stat " + fileName);
+  }
+  size = static_cast<size_t>(fileStat.st_size);
+  // An empty file can not be mapped
+  if (size > 0) {
+    void* address = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (address == MAP_FAILED) {
+      int error = errno;
+      close(fd);
+      throw std::system_error(error, std::generic_category(),
+                              "Cannot map " + fileName);
+    }
+    // The lexer reads forward only
+    madvise(address, size, MADV_SEQUENTIAL);
+    data = static_cast<const char*>(address);
+  }
+  close(fd);
+}
+
+MappedFile::~MappedFile() {
+  if (data != nullptr) munmap(const_cast<char*>(data), size);
+}
@@ -6,6 +6,7 @@
 
 #include "Expression.hpp"
 #include "Lexer.parser.hpp"
+#include "Position.parser.hpp"
 
 namespace JsCompiler {
 class ParserTest : public ::testing::Test {
@@ -40,4 +41,22 @@ TEST_F(ParserTest, ImportStatement) {
   auto expression = parser->parseExpression();
   EXPECT_EQ(dynamic_cast<ImportExpression*>(expression.get())->value, "\"a\"");
 }
+
+TEST_F(ParserTest, PretokenizedImportStatement) {
+  stream.str(R"(import "a";)");
+  parser->pretokenize();
+  auto expression = parser->parseExpression();
+  EXPECT_EQ(dynamic_cast<ImportExpression*>(expression.get())->value, "\"a\"");
+}
+
+TEST_F(ParserTest, SyntaxErrorPosition) {
+  stream.str("import \"a\";\n  )");
+  try {
+    parser->parseExpression();
+    FAIL() << "Expecting a syntax error";
+  } catch (const GeneratedParser::SyntaxError& error) {
+    EXPECT_EQ(error.offset, 14);
+    EXPECT_EQ(error.position.toString(), "2:3");
+  }
+}
 }  // namespace JsCompiler
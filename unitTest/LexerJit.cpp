@@ -0,0 +1,94 @@
+#ifdef JS_COMPILER_LEXER_JIT
+#include "LexerJit.hpp"
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace JsCompiler {
+namespace {
+// Identifiers [a-z][a-z0-9]*, with the keyword "if" on its own states
+LexerDFA createDFA() {
+  LexerDFA dfa;
+  // Class 0 is any other byte, 1 is a digit, 2 is "i", 3 is "f", 4 is a letter
+  for (char ch = '0'; ch <= '9'; ch++) dfa.byteClassMap[ch] = 1;
+  for (char ch = 'a'; ch <= 'z'; ch++) dfa.byteClassMap[ch] = 4;
+  dfa.byteClassMap['i'] = 2;
+  dfa.byteClassMap['f'] = 3;
+  dfa.byteClassCount = 5;
+  constexpr LexerDFA::StateType DEAD = LexerDFA::DEAD;
+  // 0: start, 1: identifier, 2: "i", 3: "if"
+  dfa.transitionTable = {
+      DEAD, DEAD, 2, 1, 1,  // 0
+      DEAD, 1,    1, 1, 1,  // 1
+      DEAD, 1,    1, 3, 1,  // 2
+      DEAD, 1,    1, 1, 1,  // 3
+  };
+  dfa.acceptOffsetList = {0, 0, 1, 2, 4};
+  dfa.acceptList = {0, 0, 0, 1};
+  return dfa;
+}
+
+struct ScanResult {
+  LexerDFA::StateType state;
+  size_t length;
+  size_t acceptedLength;
+
+  bool operator==(const ScanResult&) const = default;
+};
+
+ScanResult scanTable(const LexerDFA& dfa,
+                     const std::vector<bool>& acceptedList,
+                     LexerDFA::StateType state, std::string_view data) {
+  ScanResult result{state, 0, 0};
+  for (; result.length < data.size(); result.length++) {
+    const LexerDFA::StateType next =
+        dfa.next(result.state, data[result.length]);
+    if (next == LexerDFA::DEAD) break;
+    result.state = next;
+    if (acceptedList[next]) result.acceptedLength = result.length + 1;
+  }
+  return result;
+}
+
+ScanResult scanNative(LexerDFA::ScanFunction scan, LexerDFA::StateType state,
+                      std::string_view data) {
+  ScanResult result{state, 0, 0};
+  result.state = scan(state, data.data(), data.size(), &result.length,
+                      &result.acceptedLength);
+  return result;
+}
+}  // namespace
+
+TEST(LexerJit, Scan) {
+  const LexerDFA dfa = createDFA();
+  for (const uint32_t terminal : {0, 1}) {
+    const std::vector<bool> acceptedList = dfa.createAcceptedList(terminal);
+    const LexerDFA::ScanFunction scan =
+        LexerJit::getInstance().compile(dfa, acceptedList);
+    ASSERT_NE(scan, nullptr);
+    EXPECT_EQ(LexerJit::getInstance().compile(dfa, acceptedList), scan);
+    for (const std::string_view data :
+         {"", "if", "if0 ", "i", "x", "0x", "abc def", "ifx+", "\xff"}) {
+      EXPECT_EQ(scanNative(scan, LexerDFA::START, data),
+                scanTable(dfa, acceptedList, LexerDFA::START, data))
+          << terminal << " " << data;
+      // Resumed inside a token, as on a chunk boundary
+      EXPECT_EQ(scanNative(scan, 2, data),
+                scanTable(dfa, acceptedList, 2, data))
+          << terminal << " " << data;
+      // Without the accepted length
+      const ScanResult expected =
+          scanTable(dfa, acceptedList, LexerDFA::START, data);
+      size_t length = 0;
+      EXPECT_EQ(scan(LexerDFA::START, data.data(), data.size(), &length,
+                     nullptr),
+                expected.state);
+      EXPECT_EQ(length, expected.length);
+    }
+  }
+}
+}  // namespace JsCompiler
+#endif
@@ -0,0 +1,143 @@
+#include <gtest/gtest.h>
+
+#include <deque>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+
+#include "JsParser.hpp"
+#include "Lexer.parser.hpp"
+#include "Position.parser.hpp"
+#include "Token.parser.hpp"
+
+namespace JsCompiler {
+namespace {
+// Strings with spaces and semicolons make many chunks start inside a token
+std::string createSource() {
+  std::string source;
+  for (size_t i = 0; source.size() < 16 * 1024; i++)
+    source += "import \"a; " + std::string(i % 7, ' ') + "b\";\n  ;\n";
+  return source;
+}
+
+TokenBuffer tokenize(std::string_view source, size_t threadCount) {
+  return JsParser::create(Lexer::create(source))->tokenize(threadCount, 256);
+}
+}  // namespace
+
+TEST(Tokenize, Parallel) {
+  const std::string source = createSource();
+  const TokenBuffer expected = tokenize(source, 1);
+  ASSERT_GT(expected.size(), 1000);
+  EXPECT_EQ(JsParser::create(Lexer::create(source))->tokenize(), expected);
+  for (size_t threadCount : {2, 3, 8, 31})
+    EXPECT_EQ(tokenize(source, threadCount), expected) << threadCount;
+}
+
+TEST(Tokenize, ParallelSyntaxError) {
+  std::string source = createSource();
+  source.insert(source.find("  ;", source.size() / 2), "#");
+  try {
+    tokenize(source, 8);
+    FAIL() << "Expecting a syntax error";
+  } catch (const GeneratedParser::SyntaxError& error) {
+    EXPECT_EQ(error.offset, source.find('#'));
+  }
+}
+
+TEST(Tokenize, Incremental) {
+  std::deque<std::string> sourceList{createSource()};
+  auto parser = JsParser::create(Lexer::create(sourceList.back()));
+  TokenBuffer tokenBuffer = parser->tokenize();
+  struct Edit {
+    size_t offset;
+    size_t removedLength;
+    std::string inserted;
+  };
+  // Every edit is found in the source left by the edits before it
+  const std::vector<std::function<Edit(const std::string&)>> editList{
+      // Inside a string
+      [](const std::string& source) {
+        return Edit{source.find("\"a", 8 * 1024) + 1, 1, "xyz"};
+      },
+      // Split a statement
+      [](const std::string& source) {
+        return Edit{source.find("  ;", 8 * 1024) + 3, 0, "; ;"};
+      },
+      // Remove a whole line
+      [](const std::string& source) {
+        const size_t offset = source.find("import", 8 * 1024);
+        return Edit{offset, source.find('\n', offset) + 1 - offset, ""};
+      },
+      // Join two strings
+      [](const std::string& source) {
+        const size_t offset = source.find("\";", 8 * 1024);
+        return Edit{offset, source.find('"', offset + 1) + 1 - offset, ""};
+      },
+      // At the start and at the end
+      [](const std::string&) { return Edit{0, 0, ";\n"}; },
+      [](const std::string& source) { return Edit{source.size(), 0, " ;"}; },
+  };
+  for (const auto& createEdit : editList) {
+    const auto [offset, removedLength, inserted] =
+        createEdit(sourceList.back());
+    std::string source = sourceList.back();
+    source.replace(offset, removedLength, inserted);
+    const TokenBuffer expected = tokenize(source, 1);
+    sourceList.push_back(std::move(source));
+    const TokenChange change = parser->retokenize(
+        sourceList.back(), tokenBuffer,
+        {offset, removedLength, inserted.size()});
+    EXPECT_EQ(tokenBuffer, expected) << offset;
+    EXPECT_LE(change.insertedCount, 8) << offset;
+    EXPECT_LE(change.removedCount, 8) << offset;
+  }
+
+  std::string source = sourceList.back();
+  const size_t offset = source.find("import", 8 * 1024);
+  source.insert(offset, "#");
+  const TokenBuffer previous = tokenBuffer;
+  EXPECT_THROW(parser->retokenize(source, tokenBuffer, {offset, 0, 1}),
+               GeneratedParser::SyntaxError);
+  EXPECT_EQ(tokenBuffer, previous);
+}
+
+TEST(Tokenize, UnicodeIdentifier) {
+  const TokenBuffer expected = tokenize("import a", 1);
+  ASSERT_EQ(expected.size(), 2);
+  for (std::string_view name :
+       {"imports", "h\xc3\xa9llo1", "$\xe4\xb8\xad_x", "a\xcc\x81", "if1",
+        "if\xc3\xa9"}) {
+    const std::string source = "import " + std::string(name);
+    const TokenBuffer tokenBuffer = tokenize(source, 1);
+    ASSERT_EQ(tokenBuffer.size(), 2) << name;
+    EXPECT_EQ(tokenBuffer.getType(1), expected.getType(1)) << name;
+    EXPECT_EQ(tokenBuffer.getSpan(1).length, name.size()) << name;
+  }
+  // A combining mark can not start an identifier
+  EXPECT_THROW(tokenize(std::string("import \xcc\x81") + "a", 1),
+               GeneratedParser::SyntaxError);
+  EXPECT_THROW(Lexer::create("import a\xff"), std::runtime_error);
+}
+
+// The emitted scanner and the JIT, if built, tokenize the same as the
+// transition tables
+TEST(Tokenize, LexerDFAMode) {
+  using LexerDFAMode = JsParser::LexerDFAMode;
+  // Identifiers which share a prefix with a keyword, or leave the ASCII DFA
+  std::string source = "import \"a\";\n";
+  for (size_t i = 0; source.size() < 16 * 1024; i++)
+    source += "  a" + std::to_string(i) + " ;\n  if" +
+              std::string(i % 5 + 1, 'f') + " ;\n  h\xc3\xa9llo ;\n";
+  const TokenBuffer expected =
+      JsParser::create(Lexer::create(source), LexerDFAMode::Table)->tokenize();
+  ASSERT_GT(expected.size(), 1000);
+  for (const auto mode : {LexerDFAMode::Emitted, LexerDFAMode::Jit}) {
+    EXPECT_EQ(JsParser::create(Lexer::create(source), mode)->tokenize(),
+              expected);
+    EXPECT_EQ(JsParser::create(Lexer::create(source), mode)->tokenize(8, 256),
+              expected);
+  }
+}
+}  // namespace JsCompiler